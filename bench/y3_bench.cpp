@@ -0,0 +1,336 @@
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include "stress.hpp"
+#include "y3.hpp"
+
+// Scene graph benchmarks, without a window or a device: meshes and materials are
+// left empty and scenes are never rendered
+// usage: y3_bench [--max N] [--out results.json]
+
+using namespace etna;
+using Clock = std::chrono::steady_clock;
+
+// defined in lua_bindings.cpp
+ScriptHandle create_script(sol::table scriptTable);
+SceneNode create_mesh(sol::table params);
+
+struct Result {
+	std::string name;
+	size_t n;
+	size_t ops;
+	double totalTime;  // seconds, of one repetition
+};
+
+static std::vector<Result> g_results;
+
+// repeats small cases so that every measurement lasts a bit, keeps the best run
+static void measure(const std::string& name,
+					size_t n,
+					size_t ops,
+					const std::function<void()>& fn) {
+	double best = 1e30;
+	double total = 0;
+
+	for (int run = 0; run < 100 && (run < 3 || total < 0.2); run++) {
+		const auto start = Clock::now();
+		fn();
+		const std::chrono::duration<double> time = Clock::now() - start;
+
+		best = std::min(best, time.count());
+		total += time.count();
+	}
+
+	g_results.push_back({name, n, ops, best});
+
+	std::cerr << name << " n=" << n << ": " << best * 1e9 / ops << " ns/op"
+			  << std::endl;
+}
+
+static MeshNode createMesh(size_t i, const std::vector<ScriptHandle>& scripts = {}) {
+	return scene::createMeshNode({
+		.name = "node" + std::to_string(i),
+		.transform = {.position = {float(i % 7), 0, float(i % 13)}},
+		.scripts = scripts,
+	});
+}
+
+static void benchCreation(size_t n) {
+	measure("create_nodes", n, n, [n] {
+		SceneNode root = scene::createRoot("root");
+
+		for (size_t i = 0; i < n; i++) {
+			root->add(createMesh(i));
+		}
+	});
+}
+
+// wide: n children of the root, deep: a chain of n nodes, tree: fan-out of 4
+static void benchPropagation(size_t n) {
+	SceneNode wide = scene::createRoot("wide");
+
+	for (size_t i = 0; i < n; i++) {
+		wide->add(createMesh(i));
+	}
+
+	SceneNode tree = scene::createRoot("tree");
+	std::vector<SceneNode> nodes{tree};
+
+	for (size_t i = 0; i + 1 < n; i++) {
+		nodes.push_back(nodes[i / 4]->add(createMesh(i)));
+	}
+
+	Transform transform{.yaw = 0.1f};
+
+	measure("update_transform_wide", n, n,
+			[&] { wide->updateTransform(transform); });
+	measure("update_transform_tree", n, n,
+			[&] { tree->updateTransform(transform); });
+
+	// propagation recurses, very deep chains would overflow the stack
+	if (n > 10000) {
+		return;
+	}
+
+	SceneNode deep = scene::createRoot("deep");
+	SceneNode last = deep;
+
+	for (size_t i = 0; i + 1 < n; i++) {
+		last = last->add(createMesh(i));
+	}
+
+	measure("update_transform_deep", n, n,
+			[&] { deep->updateTransform(transform); });
+}
+
+static void benchLookup(size_t n) {
+	Scene scene;
+
+	for (size_t i = 0; i < n; i++) {
+		scene.addNode(createMesh(i));
+	}
+
+	std::vector<std::string> names;
+
+	for (size_t i = 0; i < n; i++) {
+		names.push_back("node" + std::to_string((i * 7919) % n));
+	}
+
+	measure("get_node", n, n, [&] {
+		for (const std::string& name : names) {
+			if (scene.getNode(name) == nullptr) {
+				throw std::runtime_error{"Missing node " + name};
+			}
+		}
+	});
+
+	// every mesh under a single root, found again by walking the graph
+	SceneNode root = scene::createRoot("root");
+
+	for (size_t i = 0; i < n; i++) {
+		root->add(createMesh(i));
+	}
+
+	measure("get_meshes", n, n, [&] { scene::getMeshes(root); });
+}
+
+static void benchScripts(sol::state& lua, size_t n) {
+	auto native = std::make_shared<Script>(Script::CreateInfo{
+		.name = "native",
+		.onUpdate = [](float, _SceneNode* node, sol::table, Scene*) {
+			node->translate(Vec3{0, 0.001f, 0});
+		},
+	});
+
+	sol::table luaInfo = lua.script(R"(
+		return {
+			name = "lua",
+			update = function(dt, node, data) data.time = data.time + dt end,
+			data = { time = 0 },
+		}
+	)");
+
+	ScriptHandle scripted = create_script(luaInfo);
+
+	for (const auto& [name, script] : {std::pair{"native", native},
+									   std::pair{"lua", scripted}}) {
+		Scene scene;
+
+		for (size_t i = 0; i < n; i++) {
+			scene.addNode(createMesh(i, {script}));
+		}
+
+		uint64_t frame = 0;
+
+		measure(std::string{"script_update_"} + name, n, n,
+				[&] { scene.applyUpdateScripts(1.f / 60, frame++); });
+	}
+}
+
+static void benchBindings(sol::state& lua, size_t n) {
+	MeshNode node = createMesh(0);
+
+	sol::protected_function getTransforms = lua.script(R"(
+		return function(node, n)
+			for i = 1, n do
+				local transform = node:get_transform()
+			end
+		end
+	)");
+
+	sol::protected_function vectorMath = lua.script(R"(
+		return function(n)
+			local v = Vec3.new(0, 0, 0)
+			local step = Vec3.new(1, 2, 3)
+			for i = 1, n do
+				v = v + step * 0.5
+			end
+			return v
+		end
+	)");
+
+	measure("lua_get_transform", n, n, [&] { getTransforms(node, n); });
+	measure("lua_vec3_math", n, n, [&] { vectorMath(n); });
+}
+
+// the y3.stress generator, on the scene graph functions only
+static void benchStress(sol::state& lua, size_t n) {
+	sol::table y3 = lua.create_table_with(
+		"create_mesh", &create_mesh,	  //
+		"create_script", &create_script,  //
+		"create_root", [](const std::string& name) {
+			return scene::createRoot(name);
+		});
+
+	sol::table stress = stress::load(lua, y3);
+	sol::protected_function generate = stress["generate"];
+
+	sol::table params = lua.create_table_with(
+		"depth", 1,				 //
+		"fanout", n,			 //
+		"scripted", 0.5,		 //
+		"materials", 0,			 //
+		"max_nodes", 2 * n);
+
+	measure("stress_generate_flat", n, n, [&] { generate(params); });
+
+	// fan-out of 10, as many levels as n allows
+	params["depth"] = static_cast<int>(std::log10(n));
+	params["fanout"] = 10;
+
+	auto [root, stats] = generate(params).get<std::tuple<SceneNode, sol::table>>();
+	const size_t meshes = stats["meshes"];
+
+	Scene scene;
+	scene.addNode(root);
+
+	uint64_t frame = 0;
+
+	measure("stress_update_tree", meshes, meshes,
+			[&] { scene.applyUpdateScripts(1.f / 60, frame++); });
+}
+
+// the same Lua work on a state with the default and with the pooling allocator
+static void benchLuaAllocator(size_t n) {
+	for (bool pooling : {false, true}) {
+		LuaAllocator::g_pooling = pooling;
+
+		LuaAllocator allocator;
+		sol::state lua{sol::default_at_panic, &LuaAllocator::allocate, &allocator};
+		lua.open_libraries(sol::lib::base, sol::lib::math, sol::lib::string);
+		y3::initLuaTypes(lua);
+
+		// short lived tables and strings, as scripts make for their state
+		sol::protected_function tables = lua.script(R"(
+			return function(n)
+				local kept = {}
+				for i = 1, n do
+					local entry = { id = i, name = "node" .. i, pos = { i, 0, i } }
+					kept[i % 64 + 1] = entry
+				end
+				return kept
+			end
+		)");
+
+		sol::protected_function vectorMath = lua.script(R"(
+			return function(n)
+				local v = Vec3.new(0, 0, 0)
+				local step = Vec3.new(1, 2, 3)
+				for i = 1, n do
+					v = v + step * 0.5
+				end
+				return v
+			end
+		)");
+
+		const std::string suffix = pooling ? "_pool" : "_default";
+
+		measure("lua_alloc_tables" + suffix, n, n, [&] { tables(n); });
+		measure("lua_alloc_vec3" + suffix, n, n, [&] { vectorMath(n); });
+
+		const LuaAllocator::Stats stats = allocator.getStats();
+
+		std::cerr << "  allocations " << stats.allocations << ", arenas "
+				  << stats.arenaBytes / 1024 << " KB" << std::endl;
+	}
+
+	LuaAllocator::g_pooling = false;
+}
+
+static void writeResults(std::ostream& out) {
+	out << "{\"benchmarks\":[\n";
+
+	for (size_t i = 0; i < g_results.size(); i++) {
+		const Result& result = g_results[i];
+
+		out << "  {\"name\":\"" << result.name << "\",\"n\":" << result.n
+			<< ",\"total_ms\":" << result.totalTime * 1e3
+			<< ",\"ns_per_op\":" << result.totalTime * 1e9 / result.ops << '}'
+			<< (i + 1 < g_results.size() ? ",\n" : "\n");
+	}
+
+	out << "]}\n";
+}
+
+int main(int argc, char** argv) {
+	size_t maxCount = 1000000;
+	std::string outPath;
+
+	for (int i = 1; i + 1 < argc; i += 2) {
+		const std::string arg = argv[i];
+
+		if (arg == "--max") {
+			maxCount = std::stoul(argv[i + 1]);
+		} else if (arg == "--out") {
+			outPath = argv[i + 1];
+		}
+	}
+
+	sol::state lua;
+	lua.open_libraries(sol::lib::base, sol::lib::math, sol::lib::string);
+	y3::initLuaTypes(lua);
+
+	try {
+		for (size_t n = 100; n <= maxCount; n *= 10) {
+			benchCreation(n);
+			benchPropagation(n);
+			benchLookup(n);
+			benchScripts(lua, n);
+			benchBindings(lua, n);
+			benchStress(lua, n);
+			benchLuaAllocator(n);
+		}
+	} catch (const std::exception& e) {
+		std::cerr << "Error in benchmark: " << e.what() << std::endl;
+		return -1;
+	}
+
+	if (outPath.empty()) {
+		writeResults(std::cout);
+	} else {
+		std::ofstream out{outPath};
+		writeResults(out);
+	}
+}
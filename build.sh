@@ -3,8 +3,13 @@
 set -xe
 
 CXX="${CXX:-c++}"
-CXX_FLAGS="-Ietna-linux_amd64/include -Isol -Letna-linux_amd64/lib"
+CXX_FLAGS="-std=c++20 -Ietna-linux_amd64/include -Isol -Letna-linux_amd64/lib"
 LIBS="-lm -letna -lglfw3 -lvulkan -lX11 -llua"
 SRC="src/*.cpp"
 
 $CXX $CXX_FLAGS -o bin/y3 $SRC $LIBS
+
+# scene graph benchmarks, headless: everything but main.cpp
+BENCH_SRC="bench/*.cpp $(ls src/*.cpp | grep -v src/main.cpp)"
+
+$CXX $CXX_FLAGS -Isrc -O2 -o bin/y3_bench $BENCH_SRC $LIBS
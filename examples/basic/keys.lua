@@ -0,0 +1,9 @@
+y3.preload_scene("other")
+
+y3.on_key(KEY_1, function()
+  y3.switch_scene("other")
+end)
+
+y3.on_key(KEY_2, function()
+  y3.switch_scene("main")
+end)
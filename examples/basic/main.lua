@@ -1,17 +1,4 @@
-y3.add_global_script(
-  y3.create_script({
-    name = "switch_scene",
-    update = function()
-      if (y3.key_clicked(KEY_1)) then
-        y3.switch_scene("other")
-      end
-
-      if (y3.key_clicked(KEY_2)) then
-        y3.switch_scene("main")
-      end
-    end,
-  })
-)
+require('keys')
 
 return {
   require('entities.camera'),
@@ -0,0 +1,48 @@
+#include "asset_cache.hpp"
+
+using namespace etna;
+
+void AssetCache::collect() {
+	std::erase_if(m_entries,
+				  [](const auto& pair) { return pair.second.handle.expired(); });
+
+	std::erase_if(m_keys, [this](const auto& pair) {
+		return !m_entries.contains(pair.second);
+	});
+}
+
+std::optional<AssetCache::Key> AssetCache::findKey(const void* asset) const {
+	auto it = m_keys.find(asset);
+
+	if (it == m_keys.end()) {
+		return std::nullopt;
+	}
+
+	// the address may have been reused since that asset was freed
+	auto entry = m_entries.find(it->second);
+
+	if (entry == m_entries.end() || entry->second.handle.lock().get() != asset) {
+		return std::nullopt;
+	}
+
+	return it->second;
+}
+
+size_t AssetCache::getBytes(const void* asset) const {
+	const std::optional<Key> key = findKey(asset);
+
+	return key ? m_entries.at(*key).bytes : 0;
+}
+
+AssetCache::Stats AssetCache::getStats() const {
+	Stats stats{.hits = m_hits, .misses = m_misses};
+
+	for (const auto& [_, entry] : m_entries) {
+		if (!entry.handle.expired()) {
+			stats.count++;
+			stats.bytes += entry.bytes;
+		}
+	}
+
+	return stats;
+}
@@ -0,0 +1,186 @@
+#pragma once
+
+#include <cstring>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+
+namespace etna {
+
+// FNV-1a over the creation parameters of an asset
+class AssetHasher {
+public:
+	explicit AssetHasher(std::string_view kind) { add(kind); }
+
+	void add(const void* data, size_t size) {
+		const auto* bytes = static_cast<const uint8_t*>(data);
+
+		for (size_t i = 0; i < size; i++) {
+			m_hash = (m_hash ^ bytes[i]) * 1099511628211ull;
+		}
+	}
+
+	void add(std::string_view str) {
+		add(str.size());
+		add(str.data(), str.size());
+	}
+
+	template <typename T>
+	void add(const T& value) {
+		static_assert(std::is_trivially_copyable_v<T>);
+		add(&value, sizeof(T));
+	}
+
+	uint64_t get() const { return m_hash; }
+
+private:
+	uint64_t m_hash{14695981039346656037ull};
+};
+
+// parameters an asset was created from, enough to create it again
+class RecipeWriter {
+public:
+	void add(const void* data, size_t size) {
+		m_bytes.append(static_cast<const char*>(data), size);
+	}
+
+	void add(std::string_view str) {
+		add(str.size());
+		add(str.data(), str.size());
+	}
+
+	template <typename T>
+	void add(const T& value) {
+		static_assert(std::is_trivially_copyable_v<T>);
+		add(&value, sizeof(T));
+	}
+
+	std::string& get() { return m_bytes; }
+
+private:
+	std::string m_bytes;
+};
+
+class RecipeReader {
+public:
+	explicit RecipeReader(std::string_view bytes) : m_bytes{bytes} {}
+
+	const void* read(size_t size) {
+		if (size > m_bytes.size() - m_offset) {
+			throw std::runtime_error{"Truncated asset recipe"};
+		}
+
+		const char* data = m_bytes.data() + m_offset;
+		m_offset += size;
+		return data;
+	}
+
+	std::string_view readString() {
+		const size_t size = read<size_t>();
+		return {static_cast<const char*>(read(size)), size};
+	}
+
+	template <typename T>
+	T read() {
+		static_assert(std::is_trivially_copyable_v<T>);
+		T value;
+		std::memcpy(&value, read(sizeof(T)), sizeof(T));
+		return value;
+	}
+
+	size_t getRemaining() const { return m_bytes.size() - m_offset; }
+
+private:
+	std::string_view m_bytes;
+	size_t m_offset{0};
+};
+
+// Note 1: the cache only holds weak handles, an asset is freed as soon as nothing
+// uses it anymore, and created again the next time it's asked for
+// Note 2: keys are 64 bit hashes of the parameters, a hit is only taken when the
+// kind and recipe match too. An asset whose key is taken by a live asset of other
+// parameters is made but not cached
+class AssetCache {
+public:
+	using Key = uint64_t;
+
+	struct Entry {
+		std::weak_ptr<void> handle;
+		std::string kind;
+		size_t bytes{0};
+		std::string recipe;
+	};
+
+	struct Stats {
+		uint32_t hits{0};
+		uint32_t misses{0};
+		size_t count{0};
+		size_t bytes{0};
+	};
+
+	// create returns the new asset and its size
+	template <typename T, typename F>
+	std::shared_ptr<T> get(std::string_view kind,
+						   Key key,
+						   RecipeWriter& recipe,
+						   F&& create) {
+		auto it = m_entries.find(key);
+		bool collision = false;
+
+		if (it != m_entries.end()) {
+			if (auto handle = it->second.handle.lock()) {
+				if (it->second.kind == kind && it->second.recipe == recipe.get()) {
+					m_hits++;
+					return std::static_pointer_cast<T>(handle);
+				}
+
+				collision = true;
+			}
+		}
+
+		m_misses++;
+
+		auto [handle, bytes] = create();
+
+		if (collision) {
+			return handle;
+		}
+
+		m_entries[key] = {
+			.handle = handle,
+			.kind = std::string{kind},
+			.bytes = bytes,
+			.recipe = std::move(recipe.get()),
+		};
+
+		m_keys[handle.get()] = key;
+
+		return handle;
+	}
+
+	// key of a live asset of the cache
+	std::optional<Key> findKey(const void* asset) const;
+
+	// size of a live asset of the cache, 0 for anything else
+	size_t getBytes(const void* asset) const;
+
+	// drops the entries of freed assets
+	void collect();
+
+	Stats getStats() const;
+
+	const std::unordered_map<Key, Entry>& getEntries() const { return m_entries; }
+
+private:
+	std::unordered_map<Key, Entry> m_entries;
+	std::unordered_map<const void*, Key> m_keys;
+
+	uint32_t m_hits{0};
+	uint32_t m_misses{0};
+};
+
+}  // namespace etna
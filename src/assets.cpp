@@ -0,0 +1,491 @@
+#include <cmath>
+#include "etna/primitives.hpp"
+#include "gpu_memory.hpp"
+#include "mapped_file.hpp"
+#include "mesh_loader.hpp"
+#include "y3.hpp"
+
+using namespace etna;
+
+static size_t getMeshBytes(const MeshHandle& mesh) {
+	return mesh->vertexCount() * sizeof(Vertex) + mesh->indexCount() * sizeof(Index);
+}
+
+static engine::GridMaterialParams getGridParams(sol::table params) {
+	Color defaultColor{WHITE};
+	Color defaultGridColor{BLACK};
+
+	return {
+		.color = params["color"].get_or(defaultColor),
+		.gridColor = params["gridColor"].get_or(defaultGridColor),
+		.gridSpacing = params["gridSpacing"].get_or(1.0f),
+		.thickness = params["thickness"].get_or(0.1f),
+	};
+}
+
+template <typename T>
+static void append_bytes(std::vector<uint8_t>& buf, const T& v) {
+	const uint8_t* p = reinterpret_cast<const uint8_t*>(&v);
+	buf.insert(buf.end(), p, p + sizeof(T));
+}
+
+static void packMaterialParams(sol::table list, std::vector<uint8_t>& buf) {
+	for (size_t i = 1; i <= list.size(); i++) {
+		sol::object v = list[i];
+
+		if (v.is<float>()) {
+			append_bytes(buf, v.as<float>());
+		} else if (v.is<int>()) {
+			append_bytes(buf, v.as<int>());
+		} else if (v.is<bool>()) {
+			buf.push_back(v.as<bool>() ? 1 : 0);
+		} else if (v.is<Vec3>()) {
+			Vec3 vec = v.as<Vec3>();
+			append_bytes(buf, vec[0]);
+			append_bytes(buf, vec[1]);
+			append_bytes(buf, vec[2]);
+		} else if (v.is<Vec4>()) {
+			Vec4 vec = v.as<Vec4>();
+			append_bytes(buf, vec[0]);
+			append_bytes(buf, vec[1]);
+			append_bytes(buf, vec[2]);
+			append_bytes(buf, vec[3]);
+		} else if (v.is<Color>()) {
+			Color c = v.as<Color>();
+			append_bytes(buf, c.r);
+			append_bytes(buf, c.g);
+			append_bytes(buf, c.b);
+			append_bytes(buf, c.a);
+		} else {
+			throw std::runtime_error{"Unsupported param type in material params"};
+		}
+	}
+}
+
+MeshHandle y3::getPrimitive(const std::string& name) {
+	static const std::unordered_map<std::string, MeshHandle (*)()> PRIMITIVES = {
+		{"sphere", engine::getSphere},
+		{"cube", engine::getCube},
+		{"pyramid", engine::getPyramid},
+		{"quad", engine::getQuad},
+	};
+
+	auto it = PRIMITIVES.find(name);
+
+	if (it == PRIMITIVES.end()) {
+		throw std::runtime_error{"Unknown primitive: " + name};
+	}
+
+	AssetHasher hasher{name};
+	RecipeWriter recipe;
+
+	// the engine keeps its own primitives alive, this is only for the accounting
+	return m_assets.get<Mesh>(name, hasher.get(), recipe, [&] {
+		gpu_memory::OwnerScope owner{gpu_memory::Owner::MESH};
+
+		MeshHandle mesh = it->second();
+		return std::pair{mesh, getMeshBytes(mesh)};
+	});
+}
+
+struct Shape {
+	// Lua names of the sizes
+	std::array<const char*, 3> sizes;
+	MeshHandle (*create)(const y3::ShapeParams&);
+};
+
+static const std::unordered_map<std::string, Shape> SHAPES = {
+	{"sphere",
+	 {{"radius"},
+	  [](const y3::ShapeParams& p) {
+		  return engine::createSphere(p.size[0], p.precision);
+	  }}},
+	{"brick",
+	 {{"width", "height", "depth"},
+	  [](const y3::ShapeParams& p) {
+		  return engine::createBrick(p.size[0], p.size[1], p.size[2]);
+	  }}},
+	{"cube",
+	 {{"side"},
+	  [](const y3::ShapeParams& p) { return engine::createCube(p.size[0]); }}},
+	{"quad",
+	 {{"width", "height"},
+	  [](const y3::ShapeParams& p) {
+		  return engine::createQuad(p.size[0], p.size[1]);
+	  }}},
+	{"pyramid",
+	 {{"height", "side"},
+	  [](const y3::ShapeParams& p) {
+		  return engine::createPyramid(p.size[0], p.size[1]);
+	  }}},
+};
+
+static const Shape& getShapeInfo(const std::string& shape) {
+	auto it = SHAPES.find(shape);
+
+	if (it == SHAPES.end()) {
+		throw std::runtime_error{"Unknown shape: " + shape};
+	}
+
+	return it->second;
+}
+
+MeshHandle y3::getShape(const std::string& shape, sol::table params) {
+	const Shape& info = getShapeInfo(shape);
+	ShapeParams shapeParams;
+
+	for (size_t i = 0; i < info.sizes.size() && info.sizes[i] != nullptr; i++) {
+		shapeParams.size[i] = params.get_or(info.sizes[i], 1.0f);
+	}
+
+	if (shape == "sphere") {
+		shapeParams.precision = params.get_or("precision", 100u);
+	}
+
+	return getShape(shape, shapeParams);
+}
+
+// Note: the engine uploads the mesh as it makes it, so shapes are made on the main
+// thread, the first time they are asked for
+MeshHandle y3::getShape(const std::string& shape, const ShapeParams& params) {
+	const Shape& info = getShapeInfo(shape);
+
+	for (float size : params.size) {
+		if (!std::isfinite(size) || size <= 0) {
+			throw std::runtime_error{"Invalid size for a " + shape};
+		}
+	}
+
+	if (shape == "sphere" && (params.precision < 3 || params.precision > 1000)) {
+		throw std::runtime_error{"Sphere precision must be between 3 and 1000"};
+	}
+
+	const std::string kind = shape + "_mesh";
+
+	AssetHasher hasher{kind};
+	hasher.add(params);
+
+	RecipeWriter recipe;
+	recipe.add(params);
+
+	return m_assets.get<Mesh>(kind, hasher.get(), recipe, [&] {
+		gpu_memory::OwnerScope owner{gpu_memory::Owner::MESH};
+
+		MeshHandle mesh = info.create(params);
+		return std::pair{mesh, getMeshBytes(mesh)};
+	});
+}
+
+// the modification time is part of the key, edited files are loaded again
+MeshHandle y3::loadMesh(const std::string& path) {
+	const int64_t time = getFileTime(path);
+
+	if (time < 0) {
+		throw std::runtime_error{"Mesh not found: " + path};
+	}
+
+	AssetHasher hasher{"mesh_file"};
+	hasher.add(std::string_view{path});
+	hasher.add(time);
+
+	// Note: the time is only there to be compared, it isn't read back
+	RecipeWriter recipe;
+	recipe.add(std::string_view{path});
+	recipe.add(time);
+
+	return m_assets.get<Mesh>("mesh_file", hasher.get(), recipe, [&] {
+		gpu_memory::OwnerScope owner{gpu_memory::Owner::MESH};
+
+		MeshHandle mesh = Mesh::create(loadMeshFile(path));
+		return std::pair{mesh, getMeshBytes(mesh)};
+	});
+}
+
+MaterialHandle y3::getColorMaterial(Color color, bool point) {
+	const std::string kind = point ? "point_material" : "color_material";
+
+	AssetHasher hasher{kind};
+	hasher.add(color);
+
+	RecipeWriter recipe;
+	recipe.add(color);
+
+	return m_assets.get<Material>(kind, hasher.get(), recipe, [&] {
+		gpu_memory::OwnerScope owner{gpu_memory::Owner::MATERIAL};
+
+		MaterialHandle material = point ? engine::createPointMaterial(color)
+										: engine::createColorMaterial(color);
+
+		return std::pair{material, sizeof(Color)};
+	});
+}
+
+MaterialHandle y3::getGridMaterial(sol::table params, bool transparent) {
+	return getGridMaterial(getGridParams(params), transparent);
+}
+
+// TEMP: transparent materials will be better handled in the future
+MaterialHandle y3::getGridMaterial(const engine::GridMaterialParams& gridParams,
+								   bool transparent) {
+	const std::string kind =
+		transparent ? "grid_material_transparent" : "grid_material";
+
+	AssetHasher hasher{kind};
+	hasher.add(gridParams);
+
+	RecipeWriter recipe;
+	recipe.add(gridParams);
+
+	return m_assets.get<Material>(kind, hasher.get(), recipe, [&] {
+		gpu_memory::OwnerScope owner{gpu_memory::Owner::MATERIAL};
+
+		MaterialHandle material =
+			transparent ? engine::createTransparentGridMaterial(gridParams)
+						: engine::createGridMaterial(gridParams);
+
+		return std::pair{material, sizeof(gridParams)};
+	});
+}
+
+MaterialTemplateHandle y3::getMaterialTemplate(sol::table params) {
+	MaterialTemplate::CreateInfo info{
+		.enableDepth = params["enableDepth"].get_or(true),
+		.transparency = params["transparency"].get_or(false),
+		.polygonMode = params["polygonMode"].get_or(VK_POLYGON_MODE_FILL),
+		.lineWidth = params["lineWidth"].get_or(1.0f),
+		.samples = params["samples"].get_or(0u),
+	};
+
+	if (params["shaders"].is<sol::table>()) {
+		sol::table shaderTable = params["shaders"];
+
+		for (const auto& kv : shaderTable) {
+			sol::object value = kv.second;
+
+			if (value.is<RawShader>()) {
+				info.rawShaders.push_back(value.as<RawShader>());
+			} else if (value.is<std::string>()) {
+				info.shaders.push_back(value.as<std::string>());
+			}
+		}
+	}
+
+	return getMaterialTemplate(info);
+}
+
+// hashed and recorded field by field, in the order the recipe is read back
+template <typename W>
+static void writeTemplateInfo(W& writer, const MaterialTemplate::CreateInfo& info) {
+	writer.add(info.shaders.size());
+
+	for (const std::string& shader : info.shaders) {
+		writer.add(std::string_view{shader});
+	}
+
+	writer.add(info.rawShaders.size());
+
+	for (const RawShader& shader : info.rawShaders) {
+		writer.add(shader.stage);
+		writer.add(shader.size);
+		writer.add(shader.code, shader.size);
+	}
+
+	writer.add(info.enableDepth);
+	writer.add(info.transparency);
+	writer.add(info.polygonMode);
+	writer.add(info.lineWidth);
+	writer.add(info.samples);
+}
+
+MaterialTemplateHandle y3::getMaterialTemplate(
+	const MaterialTemplate::CreateInfo& info) {
+	AssetHasher hasher{"material_template"};
+	writeTemplateInfo(hasher, info);
+
+	RecipeWriter recipe;
+	writeTemplateInfo(recipe, info);
+
+	return m_assets.get<MaterialTemplate>(
+		"material_template", hasher.get(), recipe, [&] {
+			gpu_memory::OwnerScope owner{gpu_memory::Owner::MATERIAL};
+
+			return std::pair{MaterialTemplate::create(info), size_t{0}};
+		});
+}
+
+// Note: materials with the same template and params are the same material, a
+// script calling updateParams on one changes all of its users
+MaterialHandle y3::getMaterial(sol::table params) {
+	sol::object raw = params["params"];
+	if (!raw.valid() || raw.get_type() != sol::type::table) {
+		throw std::runtime_error{
+			"create_material: expected params.params to be a table"};
+	}
+
+	// reused between calls, a UBO is only allocated for new params
+	m_paramsScratch.clear();
+	packMaterialParams(raw.as<sol::table>(), m_paramsScratch);
+
+	return getMaterial(params["template"], m_paramsScratch.data(),
+					   m_paramsScratch.size());
+}
+
+MaterialHandle y3::getMaterial(MaterialTemplateHandle materialTemplate,
+							   const void* params,
+							   size_t size) {
+	// templates are interned, their key is a hash of their content
+	const AssetCache::Key templateKey =
+		m_assets.findKey(materialTemplate.get())
+			.value_or(reinterpret_cast<uintptr_t>(materialTemplate.get()));
+
+	AssetHasher hasher{"material"};
+	hasher.add(templateKey);
+	hasher.add(params, size);
+
+	RecipeWriter recipe;
+	recipe.add(templateKey);
+	recipe.add(params, size);
+
+	return m_assets.get<Material>("material", hasher.get(), recipe, [&] {
+		gpu_memory::OwnerScope owner{gpu_memory::Owner::MATERIAL};
+
+		Material::CreateInfo info{
+			.templateHandle = materialTemplate,
+			.paramsSize = size,
+			.params = params,
+		};
+
+		return std::pair{Material::create(info), size};
+	});
+}
+
+std::shared_ptr<void> y3::createAsset(
+	const std::string& kind,
+	std::string_view recipe,
+	const std::unordered_map<AssetCache::Key, std::shared_ptr<void>>& created) {
+	RecipeReader reader{recipe};
+
+	if (kind == "sphere" || kind == "cube" || kind == "pyramid" || kind == "quad") {
+		return getPrimitive(kind);
+	}
+
+	if (kind == "mesh_file") {
+		return loadMesh(std::string{reader.readString()});
+	}
+
+	if (kind.ends_with("_mesh")) {
+		return getShape(kind.substr(0, kind.size() - 5),
+						reader.read<ShapeParams>());
+	}
+
+	if (kind == "color_material" || kind == "point_material") {
+		return getColorMaterial(reader.read<Color>(), kind == "point_material");
+	}
+
+	if (kind == "grid_material" || kind == "grid_material_transparent") {
+		return getGridMaterial(reader.read<engine::GridMaterialParams>(),
+							   kind == "grid_material_transparent");
+	}
+
+	if (kind == "material_template") {
+		MaterialTemplate::CreateInfo info;
+
+		for (size_t i = reader.read<size_t>(); i > 0; i--) {
+			info.shaders.emplace_back(reader.readString());
+		}
+
+		// Note: shader modules are created right away, the code doesn't have to
+		// outlive the recipe
+		for (size_t i = reader.read<size_t>(); i > 0; i--) {
+			RawShader shader{.stage = reader.read<VkShaderStageFlagBits>()};
+			shader.size = reader.read<size_t>();
+			shader.code =
+				static_cast<const unsigned char*>(reader.read(shader.size));
+			info.rawShaders.push_back(shader);
+		}
+
+		info.enableDepth = reader.read<bool>();
+		info.transparency = reader.read<bool>();
+		info.polygonMode = reader.read<VkPolygonMode>();
+		info.lineWidth = reader.read<float>();
+		info.samples = reader.read<uint32_t>();
+
+		return getMaterialTemplate(info);
+	}
+
+	if (kind == "material") {
+		auto it = created.find(reader.read<AssetCache::Key>());
+
+		if (it == created.end()) {
+			throw std::runtime_error{"Material recipe without its template"};
+		}
+
+		const size_t size = reader.getRemaining();
+
+		return getMaterial(std::static_pointer_cast<MaterialTemplate>(it->second),
+						   reader.read(size), size);
+	}
+
+	throw std::runtime_error{"Unknown asset kind: " + kind};
+}
+
+sol::object y3::getAsset(const std::string& kind, sol::table params) {
+	if (kind == "sphere" || kind == "cube" || kind == "pyramid" || kind == "quad") {
+		return sol::make_object(m_lua, getPrimitive(kind));
+	}
+
+	if (kind == "mesh_file") {
+		return sol::make_object(m_lua, loadMesh(params["path"]));
+	}
+
+	if (kind.ends_with("_mesh")) {
+		return sol::make_object(
+			m_lua, getShape(kind.substr(0, kind.size() - 5), params));
+	}
+
+	if (kind == "color_material" || kind == "point_material") {
+		Color defaultColor{WHITE};
+		const Color color = params["color"].get_or(defaultColor);
+
+		return sol::make_object(m_lua,
+								getColorMaterial(color, kind == "point_material"));
+	}
+
+	if (kind == "grid_material" || kind == "grid_material_transparent") {
+		return sol::make_object(
+			m_lua, getGridMaterial(params, kind == "grid_material_transparent"));
+	}
+
+	if (kind == "material_template") {
+		return sol::make_object(m_lua, getMaterialTemplate(params));
+	}
+
+	if (kind == "material") {
+		return sol::make_object(m_lua, getMaterial(params));
+	}
+
+	throw std::runtime_error{"Unknown asset kind: " + kind};
+}
+
+sol::table y3::getAssetStats() {
+	m_assets.collect();
+
+	const AssetCache::Stats stats = m_assets.getStats();
+
+	sol::table kinds = m_lua.create_table();
+
+	for (const auto& [_, entry] : m_assets.getEntries()) {
+		sol::table kind = kinds[entry.kind].get_or_create<sol::table>();
+
+		kind["count"] = kind.get_or("count", 0) + 1;
+		kind["refs"] = kind.get_or("refs", 0) + entry.handle.use_count();
+		kind["bytes"] = kind.get_or("bytes", size_t{0}) + entry.bytes;
+	}
+
+	return m_lua.create_table_with(
+		"hits", stats.hits,		 //
+		"misses", stats.misses,	 //
+		"count", stats.count,	 //
+		"bytes", stats.bytes,	 //
+		"kinds", kinds);
+}
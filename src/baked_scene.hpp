@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstdint>
+
+// Layout of a baked scene: the header, the arrays it points to, then a blob with the
+// strings and asset recipes. Files are mapped and read in place, they are only
+// valid for the build that wrote them
+namespace etna::baked {
+
+constexpr uint32_t MAGIC = 0x42533359;	// "Y3SB"
+constexpr uint32_t VERSION = 1;
+
+// offset and size in bytes, from the start of the file for arrays and from the
+// start of the blob for strings and recipes
+struct Span {
+	uint32_t offset{0};
+	uint32_t size{0};
+};
+
+struct Header {
+	uint32_t magic{MAGIC};
+	uint32_t version{VERSION};
+	int64_t sourceTime{0};
+	Span modules;
+	Span assets;
+	Span nodes;
+	Span scripts;
+	Span blob;
+};
+
+// module required by the scene file, required again before loading
+struct Module {
+	Span name;
+	Span path;
+	int64_t time{0};
+};
+
+// in creation order, templates come before their materials
+struct Asset {
+	uint64_t key{0};
+	Span kind;
+	Span recipe;
+};
+
+// in depth first order, parents come before their children
+struct Node {
+	uint32_t type{0};
+	int32_t parent{-1};
+	Span name;
+	float position[3];
+	float yaw, pitch, roll;
+	float scale[3];
+	int32_t mesh{-1};
+	int32_t material{-1};
+	float camera[4];  // fov, near, far, aspect
+	float viewport[4];
+	uint32_t firstScript{0};
+	uint32_t scriptCount{0};
+};
+
+}  // namespace etna::baked
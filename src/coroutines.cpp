@@ -0,0 +1,115 @@
+#include <iostream>
+#include "coroutines.hpp"
+
+using namespace etna;
+
+CoroutineScheduler::Id CoroutineScheduler::spawn(sol::state_view lua,
+												 sol::function fn) {
+	const Id id = m_nextId++;
+
+	sol::thread thread = sol::thread::create(lua.lua_state());
+	sol::coroutine coroutine(thread.state(), fn);
+
+	m_tasks.emplace(id, Task{thread, coroutine});
+
+	// run until the first wait, like a regular call
+	resume(id);
+
+	return id;
+}
+
+void CoroutineScheduler::cancel(Id id) {
+	// pending wakes of a cancelled task are skipped when they come due, but an
+	// event may never be signaled
+	m_tasks.erase(id);
+
+	for (auto it = m_events.begin(); it != m_events.end();) {
+		std::erase(it->second, id);
+		it = it->second.empty() ? m_events.erase(it) : std::next(it);
+	}
+}
+
+CoroutineScheduler::Id CoroutineScheduler::getCurrent() const {
+	if (m_current == 0) {
+		throw std::runtime_error{"y3 waits can only be used in y3.spawn functions"};
+	}
+
+	return m_current;
+}
+
+void CoroutineScheduler::waitSeconds(float seconds) {
+	m_timers.push({m_time + seconds, getCurrent()});
+}
+
+void CoroutineScheduler::waitFrames(uint32_t frames) {
+	m_frameTimers.push({m_frame + frames, getCurrent()});
+}
+
+void CoroutineScheduler::waitEvent(const std::string& event) {
+	m_events[event].push_back(getCurrent());
+}
+
+void CoroutineScheduler::signal(const std::string& event) {
+	auto it = m_events.find(event);
+
+	if (it == m_events.end()) {
+		return;
+	}
+
+	m_signaled.insert(m_signaled.end(), it->second.begin(), it->second.end());
+	m_events.erase(it);
+}
+
+void CoroutineScheduler::advance(float dt) {
+	m_time += dt;
+	m_frame++;
+}
+
+void CoroutineScheduler::update() {
+	// collect first: resumed tasks may immediately wait again
+	std::vector<Id> due;
+	due.swap(m_signaled);
+
+	while (!m_timers.empty() && m_timers.top().when <= m_time) {
+		due.push_back(m_timers.top().id);
+		m_timers.pop();
+	}
+
+	while (!m_frameTimers.empty() && m_frameTimers.top().when <= m_frame) {
+		due.push_back(m_frameTimers.top().id);
+		m_frameTimers.pop();
+	}
+
+	for (Id id : due) {
+		resume(id);
+	}
+}
+
+void CoroutineScheduler::resume(Id id) {
+	auto it = m_tasks.find(id);
+
+	if (it == m_tasks.end()) {
+		return;
+	}
+
+	// copy: the task map can be modified by the coroutine itself
+	sol::coroutine coroutine = it->second.coroutine;
+
+	const Id previous = m_current;
+	m_current = id;
+
+	sol::protected_function_result result = coroutine();
+
+	m_current = previous;
+
+	if (!result.valid()) {
+		sol::error err = result;
+		std::cerr << "Error in coroutine: " << err.what() << std::endl;
+		m_tasks.erase(id);
+		return;
+	}
+
+	if (!coroutine.runnable()) {
+		m_tasks.erase(id);
+	}
+}
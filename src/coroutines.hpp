@@ -0,0 +1,70 @@
+#pragma once
+
+#include <queue>
+#include <unordered_map>
+#include "sol.hpp"
+
+namespace etna {
+
+// Note: dormant coroutines cost nothing per frame, they are resumed only when the
+// timer, frame or event they are waiting for is due
+class CoroutineScheduler {
+public:
+	using Id = uint32_t;
+
+	Id spawn(sol::state_view, sol::function);
+
+	void cancel(Id);
+
+	void waitSeconds(float seconds);
+
+	void waitFrames(uint32_t frames);
+
+	void waitEvent(const std::string& event);
+
+	void signal(const std::string& event);
+
+	// at the start of a frame, so that waits started by the hooks of the frame
+	// count from it
+	void advance(float dt);
+
+	// after the hooks, resumes what is due
+	void update();
+
+	size_t getCount() const { return m_tasks.size(); }
+
+private:
+	struct Task {
+		sol::thread thread;
+		sol::coroutine coroutine;
+	};
+
+	template <typename T>
+	struct Wake {
+		T when;
+		Id id;
+
+		bool operator>(const Wake& other) const { return when > other.when; }
+	};
+
+	template <typename T>
+	using WakeHeap =
+		std::priority_queue<Wake<T>, std::vector<Wake<T>>, std::greater<Wake<T>>>;
+
+	std::unordered_map<Id, Task> m_tasks;
+	WakeHeap<double> m_timers;
+	WakeHeap<uint64_t> m_frameTimers;
+	std::unordered_map<std::string, std::vector<Id>> m_events;
+	std::vector<Id> m_signaled;
+
+	double m_time{0};
+	uint64_t m_frame{0};
+	Id m_current{0};
+	Id m_nextId{1};
+
+	Id getCurrent() const;
+
+	void resume(Id);
+};
+
+}  // namespace etna
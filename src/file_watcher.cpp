@@ -0,0 +1,89 @@
+#include <sys/inotify.h>
+#include <unistd.h>
+#include <algorithm>
+#include <filesystem>
+#include <iostream>
+#include "file_watcher.hpp"
+
+namespace fs = std::filesystem;
+using namespace etna;
+
+// Note: editors either write in place or write a copy and move it over the file
+static constexpr uint32_t FILE_EVENTS = IN_CLOSE_WRITE | IN_MOVED_TO;
+
+FileWatcher::FileWatcher(const std::string& dir) {
+	m_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+
+	if (m_fd < 0) {
+		std::cerr << "Warning: can't watch " << dir << ", inotify unavailable\n";
+		return;
+	}
+
+	addDir(dir);
+
+	std::error_code error;
+
+	for (const auto& entry : fs::recursive_directory_iterator(dir, error)) {
+		if (entry.is_directory()) {
+			addDir(entry.path().string());
+		}
+	}
+}
+
+FileWatcher::~FileWatcher() {
+	if (m_fd >= 0) {
+		close(m_fd);
+	}
+}
+
+void FileWatcher::addDir(const std::string& dir) {
+	const int wd = inotify_add_watch(m_fd, dir.c_str(), FILE_EVENTS | IN_CREATE);
+
+	if (wd >= 0) {
+		m_dirs[wd] = dir;
+	}
+}
+
+std::vector<std::string> FileWatcher::poll() {
+	std::vector<std::string> paths;
+
+	if (m_fd < 0) {
+		return paths;
+	}
+
+	alignas(inotify_event) char buffer[4096];
+
+	while (true) {
+		const ssize_t size = read(m_fd, buffer, sizeof(buffer));
+
+		if (size <= 0) {
+			break;
+		}
+
+		for (ssize_t offset = 0; offset < size;) {
+			const auto* event =
+				reinterpret_cast<const inotify_event*>(buffer + offset);
+			offset += sizeof(inotify_event) + event->len;
+
+			auto dir = m_dirs.find(event->wd);
+
+			if (dir == m_dirs.end() || event->len == 0) {
+				continue;
+			}
+
+			const std::string path = dir->second + "/" + event->name;
+
+			if (event->mask & IN_ISDIR) {
+				if (event->mask & (IN_CREATE | IN_MOVED_TO)) {
+					addDir(path);
+				}
+			} else if (event->mask & FILE_EVENTS) {
+				if (std::find(paths.begin(), paths.end(), path) == paths.end()) {
+					paths.push_back(path);
+				}
+			}
+		}
+	}
+
+	return paths;
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace etna {
+
+// inotify watch over a directory and its subdirectories, invalid if inotify isn't
+// available
+// Note 1: never blocks, the events queue up in the kernel until the next poll
+// Note 2: new directories are watched from the poll that sees them, files written
+// in them before that are missed
+class FileWatcher {
+public:
+	explicit FileWatcher(const std::string& dir);
+
+	~FileWatcher();
+
+	bool isValid() const { return m_fd >= 0; }
+
+	// files written or moved in since the previous poll, each listed once
+	std::vector<std::string> poll();
+
+private:
+	int m_fd{-1};
+	std::unordered_map<int, std::string> m_dirs;
+
+	void addDir(const std::string& dir);
+
+public:
+	FileWatcher(const FileWatcher&) = delete;
+	FileWatcher& operator=(const FileWatcher&) = delete;
+	FileWatcher(FileWatcher&&) = delete;
+	FileWatcher& operator=(FileWatcher&&) = delete;
+};
+
+}  // namespace etna
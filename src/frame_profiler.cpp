@@ -0,0 +1,158 @@
+#include <algorithm>
+#include <iostream>
+#include "frame_profiler.hpp"
+#include "trace.hpp"
+
+using namespace etna;
+
+static float secondsBetween(FrameProfiler::Clock::time_point start,
+							FrameProfiler::Clock::time_point end) {
+	return std::chrono::duration<float>(end - start).count();
+}
+
+const char* FrameProfiler::getName(size_t stat) {
+	static constexpr const char* NAMES[] = {
+		"time",			  //
+		"events",		  //
+		"input",		  //
+		"hot_reload",	  //
+		"fixed_update",	  //
+		"update",		  //
+		"parallel",		  //
+		"global_scripts",  //
+		"coroutines",	  //
+		"preload",		  //
+		"render",		  //
+		"gc",			  //
+		"swap",			  //
+		"limit",		  //
+		"gpu",			  //
+		"frame",
+	};
+
+	return NAMES[stat];
+}
+
+void FrameProfiler::beginFrame() {
+	m_frameStart = Clock::now();
+	m_phaseStart = m_frameStart;
+	m_current = {};
+	m_current[GPU_STAT] = -1;
+}
+
+// a phase can end more than once per frame, its times add up
+void FrameProfiler::endPhase(Phase phase) {
+	const auto now = Clock::now();
+	const auto stat = static_cast<size_t>(phase);
+
+	m_current[stat] += secondsBetween(m_phaseStart, now);
+
+	if (trace::isRecording()) {
+		trace::record(getName(stat), "phase", m_phaseStart, now);
+	}
+
+	m_phaseStart = now;
+}
+
+void FrameProfiler::endFrame() {
+	const auto now = Clock::now();
+
+	m_current[FRAME_STAT] = secondsBetween(m_frameStart, now);
+
+	if (trace::isRecording()) {
+		trace::record("frame", "frame", m_frameStart, now);
+	}
+
+	m_frames[m_next] = m_current;
+	m_next = (m_next + 1) % FRAME_COUNT;
+	m_count = std::min(m_count + 1, FRAME_COUNT);
+	m_total++;
+
+	if (!m_summary) {
+		m_summaryFrames = 0;
+		return;
+	}
+
+	if (m_summaryFrames++ == 0) {
+		m_summaryStart = now;
+	} else if (secondsBetween(m_summaryStart, now) >= 1) {
+		printSummary();
+		m_summaryFrames = 0;
+	}
+}
+
+void FrameProfiler::setGpuTime(uint64_t frame, float seconds) {
+	if (frame >= m_total || m_total - frame > m_count) {
+		return;
+	}
+
+	const auto age = static_cast<uint32_t>(m_total - frame);
+	m_frames[(m_next + FRAME_COUNT - age) % FRAME_COUNT][GPU_STAT] = seconds;
+}
+
+std::array<FrameProfiler::Stats, FrameProfiler::STAT_COUNT> FrameProfiler::getStats(
+	uint32_t frames) const {
+	std::array<Stats, STAT_COUNT> stats{};
+
+	frames = std::min(frames, m_count);
+
+	if (frames == 0) {
+		return stats;
+	}
+
+	std::vector<float> times;
+
+	for (size_t i = 0; i < STAT_COUNT; i++) {
+		times.clear();
+
+		// newest first, going back from the last frame written, frames without a
+		// GPU time have a negative one
+		for (uint32_t j = 0; j < frames; j++) {
+			const float time =
+				m_frames[(m_next + FRAME_COUNT - 1 - j) % FRAME_COUNT][i];
+
+			if (time >= 0) {
+				times.push_back(time);
+			}
+		}
+
+		if (times.empty()) {
+			continue;
+		}
+
+		const auto p99 = times.begin() + (times.size() - 1) * 99 / 100;
+		std::nth_element(times.begin(), p99, times.end());
+
+		float sum = 0;
+
+		for (float time : times) {
+			sum += time;
+		}
+
+		stats[i] = {
+			.min = *std::min_element(times.begin(), times.end()),
+			.avg = sum / times.size(),
+			.p99 = *p99,
+			.max = *std::max_element(times.begin(), times.end()),
+		};
+	}
+
+	return stats;
+}
+
+// only the phases that took some time
+void FrameProfiler::printSummary() {
+	const auto stats = getStats(m_summaryFrames);
+	const Stats& frame = stats[FRAME_STAT];
+
+	std::cout << "Frame " << frame.avg * 1000 << " ms (p99 " << frame.p99 * 1000
+			  << ", " << m_summaryFrames << " frames) |";
+
+	for (size_t i = 0; i < FRAME_STAT; i++) {
+		if (stats[i].avg >= 0.00005f) {
+			std::cout << ' ' << getName(i) << ' ' << stats[i].avg * 1000;
+		}
+	}
+
+	std::cout << std::endl;
+}
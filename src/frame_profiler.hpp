@@ -0,0 +1,96 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <vector>
+
+namespace etna {
+
+// Times the phases of the frames into a ring buffer of the last FRAME_COUNT frames
+// Note: phases are back to back, each one lasts from the end of the previous one,
+// so a frame costs a clock read per phase
+class FrameProfiler {
+public:
+	using Clock = std::chrono::steady_clock;
+
+	static constexpr uint32_t FRAME_COUNT = 300;
+
+	enum class Phase : uint8_t {
+		TIME,
+		EVENTS,
+		INPUT,
+		HOT_RELOAD,
+		FIXED_UPDATE,
+		UPDATE,
+		PARALLEL,
+		GLOBAL_SCRIPTS,
+		COROUTINES,
+		PRELOAD,
+		RENDER,
+		GC,
+		SWAP,
+		LIMIT,
+		COUNT,
+	};
+
+	// after the phases come the GPU time and the whole frame
+	static constexpr size_t GPU_STAT = static_cast<size_t>(Phase::COUNT);
+	static constexpr size_t FRAME_STAT = GPU_STAT + 1;
+	static constexpr size_t STAT_COUNT = FRAME_STAT + 1;
+
+	// in seconds
+	struct Stats {
+		float min{0};
+		float avg{0};
+		float p99{0};
+		float max{0};
+	};
+
+	static const char* getName(size_t stat);
+
+	void beginFrame();
+
+	void endPhase(Phase);
+
+	void endFrame();
+
+	// number of the frame being timed
+	uint64_t getFrameNumber() const { return m_total; }
+
+	// GPU times come a few frames late, they go to their frame if it's still kept
+	void setGpuTime(uint64_t frame, float seconds);
+
+	// over the last frames, at most FRAME_COUNT, the GPU time only over the frames
+	// that have one
+	std::array<Stats, STAT_COUNT> getStats(uint32_t frames = FRAME_COUNT) const;
+
+	uint32_t getFrameCount() const { return m_count; }
+
+	// of the last frame ended, in seconds
+	float getLastFrameTime() const {
+		return m_frames[(m_next + FRAME_COUNT - 1) % FRAME_COUNT][FRAME_STAT];
+	}
+
+	// prints the averages of the last second to the console, once a second
+	void setSummary(bool enabled) { m_summary = enabled; }
+
+private:
+	using Times = std::array<float, STAT_COUNT>;
+
+	std::vector<Times> m_frames = std::vector<Times>(FRAME_COUNT);
+	uint32_t m_next{0};
+	uint32_t m_count{0};
+	uint64_t m_total{0};
+
+	Clock::time_point m_frameStart;
+	Clock::time_point m_phaseStart;
+	Times m_current{};
+
+	bool m_summary{false};
+	uint32_t m_summaryFrames{0};
+	Clock::time_point m_summaryStart;
+
+	void printSummary();
+};
+
+}  // namespace etna
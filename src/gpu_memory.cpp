@@ -0,0 +1,137 @@
+#include <mutex>
+#include <unordered_map>
+#include <vulkan/vulkan_core.h>
+#include "gpu_memory.hpp"
+#include "vulkan_loader.hpp"
+
+using namespace etna;
+using gpu_memory::Owner;
+
+namespace {
+
+struct BufferRecord {
+	Owner owner;
+	VkDeviceSize size;
+};
+
+struct MemoryState {
+	std::mutex mutex;
+	std::unordered_map<VkBuffer, BufferRecord> buffers;
+	std::unordered_map<VkDeviceMemory, VkDeviceSize> allocations;
+	gpu_memory::Stats stats;
+};
+
+MemoryState g_state;
+
+thread_local Owner t_owner = Owner::OTHER;
+
+}  // namespace
+
+const char* gpu_memory::getOwnerName(Owner owner) {
+	static constexpr const char* NAMES[] = {
+		"other", "scene", "camera", "light", "material", "mesh",
+	};
+
+	return NAMES[static_cast<size_t>(owner)];
+}
+
+gpu_memory::Stats gpu_memory::getStats() {
+	std::lock_guard lock{g_state.mutex};
+	return g_state.stats;
+}
+
+gpu_memory::OwnerScope::OwnerScope(Owner owner) : m_previous{t_owner} {
+	t_owner = owner;
+}
+
+gpu_memory::OwnerScope::~OwnerScope() {
+	t_owner = m_previous;
+}
+
+// interposed vulkan entry points
+
+VKAPI_ATTR VkResult VKAPI_CALL
+vkCreateBuffer(VkDevice device,
+			   const VkBufferCreateInfo* pCreateInfo,
+			   const VkAllocationCallbacks* pAllocator,
+			   VkBuffer* pBuffer) {
+	static const auto next = getLoaderFunction<PFN_vkCreateBuffer>("vkCreateBuffer");
+
+	const VkResult result = next(device, pCreateInfo, pAllocator, pBuffer);
+
+	if (result == VK_SUCCESS) {
+		std::lock_guard lock{g_state.mutex};
+
+		g_state.buffers[*pBuffer] = {t_owner, pCreateInfo->size};
+
+		gpu_memory::Usage& usage =
+			g_state.stats.buffers[static_cast<size_t>(t_owner)];
+		usage.count++;
+		usage.bytes += pCreateInfo->size;
+	}
+
+	return result;
+}
+
+VKAPI_ATTR void VKAPI_CALL vkDestroyBuffer(VkDevice device,
+										   VkBuffer buffer,
+										   const VkAllocationCallbacks* pAllocator) {
+	static const auto next =
+		getLoaderFunction<PFN_vkDestroyBuffer>("vkDestroyBuffer");
+
+	if (buffer != VK_NULL_HANDLE) {
+		std::lock_guard lock{g_state.mutex};
+
+		if (auto it = g_state.buffers.find(buffer); it != g_state.buffers.end()) {
+			gpu_memory::Usage& usage =
+				g_state.stats.buffers[static_cast<size_t>(it->second.owner)];
+			usage.count--;
+			usage.bytes -= it->second.size;
+
+			g_state.buffers.erase(it);
+		}
+	}
+
+	next(device, buffer, pAllocator);
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL
+vkAllocateMemory(VkDevice device,
+				 const VkMemoryAllocateInfo* pAllocateInfo,
+				 const VkAllocationCallbacks* pAllocator,
+				 VkDeviceMemory* pMemory) {
+	static const auto next =
+		getLoaderFunction<PFN_vkAllocateMemory>("vkAllocateMemory");
+
+	const VkResult result = next(device, pAllocateInfo, pAllocator, pMemory);
+
+	if (result == VK_SUCCESS) {
+		std::lock_guard lock{g_state.mutex};
+
+		g_state.allocations[*pMemory] = pAllocateInfo->allocationSize;
+		g_state.stats.memory.count++;
+		g_state.stats.memory.bytes += pAllocateInfo->allocationSize;
+	}
+
+	return result;
+}
+
+VKAPI_ATTR void VKAPI_CALL vkFreeMemory(VkDevice device,
+										VkDeviceMemory memory,
+										const VkAllocationCallbacks* pAllocator) {
+	static const auto next = getLoaderFunction<PFN_vkFreeMemory>("vkFreeMemory");
+
+	if (memory != VK_NULL_HANDLE) {
+		std::lock_guard lock{g_state.mutex};
+
+		if (auto it = g_state.allocations.find(memory);
+			it != g_state.allocations.end()) {
+			g_state.stats.memory.count--;
+			g_state.stats.memory.bytes -= it->second;
+
+			g_state.allocations.erase(it);
+		}
+	}
+
+	next(device, memory, pAllocator);
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+// Note: etna creates its buffers and memory without telling y3, so
+// vkCreateBuffer, vkAllocateMemory and their frees are interposed in
+// gpu_memory.cpp. Buffers are counted for the owner of the scope they were
+// created in, the memory is the device memory etna's allocator took in blocks
+namespace etna::gpu_memory {
+
+enum class Owner : uint8_t {
+	OTHER,
+	SCENE,
+	CAMERA,
+	LIGHT,
+	MATERIAL,
+	MESH,
+	COUNT,
+};
+
+struct Usage {
+	size_t count{0};
+	size_t bytes{0};
+};
+
+struct Stats {
+	std::array<Usage, static_cast<size_t>(Owner::COUNT)> buffers;
+	Usage memory;
+};
+
+const char* getOwnerName(Owner);
+
+Stats getStats();
+
+// buffers created on this thread while it lives belong to the owner
+class OwnerScope {
+public:
+	explicit OwnerScope(Owner);
+
+	~OwnerScope();
+
+private:
+	Owner m_previous;
+
+public:
+	OwnerScope(const OwnerScope&) = delete;
+	OwnerScope& operator=(const OwnerScope&) = delete;
+	OwnerScope(OwnerScope&&) = delete;
+	OwnerScope& operator=(OwnerScope&&) = delete;
+};
+
+}  // namespace etna::gpu_memory
@@ -0,0 +1,337 @@
+#include <iostream>
+#include "etna/engine.hpp"
+#include "gpu_profiler.hpp"
+
+using namespace etna;
+
+// set when the device was created with hostQueryReset
+static bool g_hostQueryReset = false;
+
+// the copy of a struct of the chain, nullptr for types that aren't copied
+static VkBaseOutStructure* copyFeatures(const VkBaseInStructure* next,
+										GpuProfiler::DeviceFeatures& storage) {
+	auto copy = [&]<typename T>(T& to) {
+		to = *reinterpret_cast<const T*>(next);
+		return reinterpret_cast<VkBaseOutStructure*>(&to);
+	};
+
+	switch (next->sType) {
+		case VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2:
+			return copy(storage.features2);
+		case VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_1_FEATURES:
+			return copy(storage.vulkan11);
+		case VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES:
+			return copy(storage.vulkan12);
+		case VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES:
+			return copy(storage.vulkan13);
+		case VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_HOST_QUERY_RESET_FEATURES:
+			return copy(storage.hostQueryReset);
+		default:
+			return nullptr;
+	}
+}
+
+// Note: the features are only queried on 1.2 devices, etna's instance is at
+// least 1.3 for dynamic rendering
+VkDeviceCreateInfo GpuProfiler::enableDeviceFeatures(
+	VkPhysicalDevice physicalDevice,
+	const VkDeviceCreateInfo& info,
+	DeviceFeatures& storage) {
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+
+	if (properties.apiVersion < VK_API_VERSION_1_2) {
+		return info;
+	}
+
+	VkPhysicalDeviceHostQueryResetFeatures supported{
+		.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_HOST_QUERY_RESET_FEATURES,
+	};
+
+	VkPhysicalDeviceFeatures2 features{
+		.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2,
+		.pNext = &supported,
+	};
+
+	vkGetPhysicalDeviceFeatures2(physicalDevice, &features);
+
+	if (!supported.hostQueryReset) {
+		return info;
+	}
+
+	const VkBaseInStructure* found = nullptr;
+
+	for (auto* next = static_cast<const VkBaseInStructure*>(info.pNext);
+		 next != nullptr && found == nullptr; next = next->pNext) {
+		if (next->sType == VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES ||
+			next->sType ==
+				VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_HOST_QUERY_RESET_FEATURES) {
+			found = next;
+		}
+	}
+
+	VkDeviceCreateInfo result = info;
+
+	if (found == nullptr) {
+		storage.hostQueryReset = {
+			.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_HOST_QUERY_RESET_FEATURES,
+			.pNext = const_cast<void*>(info.pNext),
+			.hostQueryReset = VK_TRUE,
+		};
+
+		result.pNext = &storage.hostQueryReset;
+		g_hostQueryReset = true;
+
+		return result;
+	}
+
+	// a feature can't be in two structs of the chain, the one etna passes is
+	// turned on in a copy. The chain is etna's, so it's copied up to that struct
+	// and the rest is shared
+	VkBaseOutStructure* last = nullptr;
+
+	for (auto* next = static_cast<const VkBaseInStructure*>(info.pNext);;
+		 next = next->pNext) {
+		VkBaseOutStructure* copy = copyFeatures(next, storage);
+
+		if (copy == nullptr) {
+			std::cerr << "Warning: can't turn on hostQueryReset, unknown struct "
+						 "in the device create info"
+					  << std::endl;
+			return info;
+		}
+
+		if (last == nullptr) {
+			result.pNext = copy;
+		} else {
+			last->pNext = copy;
+		}
+
+		last = copy;
+
+		if (next == found) {
+			break;
+		}
+	}
+
+	if (found->sType == VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES) {
+		storage.vulkan12.hostQueryReset = VK_TRUE;
+	} else {
+		storage.hostQueryReset.hostQueryReset = VK_TRUE;
+	}
+
+	g_hostQueryReset = true;
+
+	return result;
+}
+
+GpuProfiler::~GpuProfiler() {
+	if (m_pool != VK_NULL_HANDLE) {
+		engine::getDevice().waitIdle();
+		vkDestroyQueryPool(m_device, m_pool, nullptr);
+	}
+}
+
+void GpuProfiler::setEnabled(bool enabled) {
+	m_enabled = enabled;
+
+	if (!enabled) {
+		m_current = nullptr;
+	}
+}
+
+bool GpuProfiler::createPool() {
+	const ignis::Device& device = engine::getDevice();
+	const VkPhysicalDeviceProperties properties =
+		device.getPhysicalDeviceProperties();
+
+	m_device = device.getDevice();
+	m_period = properties.limits.timestampPeriod;
+
+	if (g_hostQueryReset) {
+		m_reset = reinterpret_cast<PFN_vkResetQueryPool>(
+			vkGetDeviceProcAddr(m_device, "vkResetQueryPool"));
+	}
+
+	if (!properties.limits.timestampComputeAndGraphics || m_reset == nullptr) {
+		std::cerr << "Warning: GPU timestamps aren't supported on "
+				  << properties.deviceName << std::endl;
+		return false;
+	}
+
+	const VkQueryPoolCreateInfo info{
+		.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+		.queryType = VK_QUERY_TYPE_TIMESTAMP,
+		.queryCount = MAX_QUERIES * FRAME_LATENCY,
+	};
+
+	if (vkCreateQueryPool(m_device, &info, nullptr, &m_pool) != VK_SUCCESS) {
+		std::cerr << "Error in GPU profiler: can't create the query pool"
+				  << std::endl;
+		return false;
+	}
+
+	m_reset(m_device, m_pool, 0, info.queryCount);
+	m_results.resize(MAX_QUERIES);
+
+	return true;
+}
+
+std::optional<GpuProfiler::FrameTime> GpuProfiler::beginFrame(uint64_t frame) {
+	m_current = nullptr;
+
+	if (!m_enabled || !m_available) {
+		return std::nullopt;
+	}
+
+	if (m_pool == VK_NULL_HANDLE && !(m_available = createPool())) {
+		return std::nullopt;
+	}
+
+	FrameSet& set = m_sets[m_nextSet];
+	std::optional<FrameTime> result;
+
+	if (set.pending) {
+		result = readBack(set);
+
+		// still in flight, this frame goes untimed
+		if (set.pending) {
+			return std::nullopt;
+		}
+	}
+
+	set.frame = frame;
+	set.used = 0;
+	set.markers.clear();
+	set.pending = true;
+
+	m_current = &set;
+	m_pass = 0;
+	m_passMarker = 0;
+	m_nextSet = (m_nextSet + 1) % FRAME_LATENCY;
+
+	return result;
+}
+
+uint32_t GpuProfiler::writeTimestamp(VkCommandBuffer cmd) {
+	const uint32_t query = m_current->used++;
+	const uint32_t base = static_cast<uint32_t>(m_current - m_sets) * MAX_QUERIES;
+
+	vkCmdWriteTimestamp(cmd, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, m_pool,
+						base + query);
+
+	return query;
+}
+
+// a pass takes at least two queries, one is always left for its end
+void GpuProfiler::beginPass(VkCommandBuffer cmd, std::string_view camera) {
+	if (m_current == nullptr) {
+		return;
+	}
+
+	m_passMarker = m_current->markers.size();
+
+	if (m_current->used + 2 > MAX_QUERIES) {
+		return;
+	}
+
+	m_lastQuery = writeTimestamp(cmd);
+	m_batchDraws = 0;
+
+	m_current->markers.push_back({
+		.name = std::string{camera},
+		.pass = m_pass,
+		.batch = false,
+		.start = m_lastQuery,
+	});
+}
+
+void GpuProfiler::endBatch(VkCommandBuffer cmd, uint32_t draws) {
+	if (m_current == nullptr || m_passMarker >= m_current->markers.size()) {
+		return;
+	}
+
+	m_batchDraws += draws;
+
+	if (m_current->used + 2 > MAX_QUERIES) {
+		return;
+	}
+
+	const uint32_t query = writeTimestamp(cmd);
+	const Marker& pass = m_current->markers[m_passMarker];
+
+	m_current->markers.push_back({
+		.name = pass.name + " batch " +
+				std::to_string(m_current->markers.size() - m_passMarker),
+		.pass = m_pass,
+		.batch = true,
+		.draws = m_batchDraws,
+		.start = m_lastQuery,
+		.end = query,
+	});
+
+	m_lastQuery = query;
+	m_batchDraws = 0;
+}
+
+void GpuProfiler::endPass(VkCommandBuffer cmd) {
+	if (m_current == nullptr || m_passMarker >= m_current->markers.size()) {
+		return;
+	}
+
+	Marker& pass = m_current->markers[m_passMarker];
+
+	if (m_lastQuery == pass.start || m_batchDraws > 0) {
+		m_lastQuery = writeTimestamp(cmd);
+	}
+
+	pass.end = m_lastQuery;
+	pass.draws = m_batchDraws;
+
+	for (size_t i = m_passMarker + 1; i < m_current->markers.size(); i++) {
+		pass.draws += m_current->markers[i].draws;
+	}
+
+	m_pass++;
+	m_passMarker = m_current->markers.size();
+}
+
+std::optional<GpuProfiler::FrameTime> GpuProfiler::readBack(FrameSet& set) {
+	const uint32_t base = static_cast<uint32_t>(&set - m_sets) * MAX_QUERIES;
+
+	if (set.used > 0) {
+		const VkResult result = vkGetQueryPoolResults(
+			m_device, m_pool, base, set.used, set.used * sizeof(uint64_t),
+			m_results.data(), sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+
+		if (result == VK_NOT_READY) {
+			return std::nullopt;
+		}
+
+		m_reset(m_device, m_pool, base, set.used);
+	}
+
+	set.pending = false;
+
+	FrameTime frameTime{.frame = set.frame, .time = 0};
+	m_spans.clear();
+
+	for (const Marker& marker : set.markers) {
+		const uint64_t ticks = m_results[marker.end] - m_results[marker.start];
+		const float time = static_cast<float>(ticks) * m_period * 1e-9f;
+
+		m_spans.push_back({
+			.name = marker.name,
+			.pass = marker.pass,
+			.batch = marker.batch,
+			.draws = marker.draws,
+			.time = time,
+		});
+
+		if (!marker.batch) {
+			frameTime.time += time;
+		}
+	}
+
+	return frameTime;
+}
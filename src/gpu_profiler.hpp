@@ -0,0 +1,123 @@
+#pragma once
+
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <vulkan/vulkan_core.h>
+
+namespace etna {
+
+// GPU time of the camera passes and of the draw batches in them, from timestamps
+// written into the renderer's command buffers
+// Note 1: results are read back FRAME_LATENCY frames later without waiting on the
+// GPU, a frame whose set of queries is still in use is not timed
+// Note 2: queries are reset from the host, they can't be reset inside the render
+// pass the renderer begins, so the device needs hostQueryReset
+// (see enableDeviceFeatures)
+class GpuProfiler {
+public:
+	static constexpr uint32_t FRAME_LATENCY = 4;
+
+	// per frame, batches past it are merged with the next one
+	static constexpr uint32_t MAX_QUERIES = 256;
+
+	// a camera pass, or a batch of draws with the same material in it
+	struct Span {
+		std::string name;
+		uint32_t pass;
+		bool batch;
+		uint32_t draws;
+		float time;	 // seconds
+	};
+
+	struct FrameTime {
+		uint64_t frame;
+		float time;	 // seconds, of all the passes
+	};
+
+	// copies of the feature structs put in a device create info, one per type as
+	// a chain can't have two structs of the same type
+	struct DeviceFeatures {
+		VkPhysicalDeviceFeatures2 features2;
+		VkPhysicalDeviceVulkan11Features vulkan11;
+		VkPhysicalDeviceVulkan12Features vulkan12;
+		VkPhysicalDeviceVulkan13Features vulkan13;
+		VkPhysicalDeviceHostQueryResetFeatures hostQueryReset;
+	};
+
+	// turns on hostQueryReset in a device being created, when the device has it
+	// Note: called from the interposed vkCreateDevice, the structs that are changed
+	// or added are kept in storage until the device is created
+	static VkDeviceCreateInfo enableDeviceFeatures(VkPhysicalDevice,
+												   const VkDeviceCreateInfo&,
+												   DeviceFeatures& storage);
+
+	~GpuProfiler();
+
+	void setEnabled(bool);
+
+	bool isEnabled() const { return m_enabled; }
+
+	// reads back the oldest frame and starts timing the given one
+	std::optional<FrameTime> beginFrame(uint64_t frame);
+
+	// false when the current frame isn't timed, the calls below do nothing then
+	bool isTiming() const { return m_current != nullptr; }
+
+	void beginPass(VkCommandBuffer, std::string_view camera);
+
+	// ends the batch of the last draws, when the material changes
+	void endBatch(VkCommandBuffer, uint32_t draws);
+
+	void endPass(VkCommandBuffer);
+
+	// of the last frame read back
+	const std::vector<Span>& getSpans() const { return m_spans; }
+
+private:
+	struct Marker {
+		std::string name;
+		uint32_t pass;
+		bool batch;
+		uint32_t draws;
+		uint32_t start;
+		uint32_t end;
+	};
+
+	struct FrameSet {
+		uint64_t frame{0};
+		uint32_t used{0};
+		bool pending{false};
+		std::vector<Marker> markers;
+	};
+
+	bool m_enabled{false};
+	bool m_available{true};
+
+	VkDevice m_device{VK_NULL_HANDLE};
+	VkQueryPool m_pool{VK_NULL_HANDLE};
+	PFN_vkResetQueryPool m_reset{nullptr};
+	float m_period{1};	// nanoseconds per tick
+
+	FrameSet m_sets[FRAME_LATENCY];
+	uint32_t m_nextSet{0};
+	FrameSet* m_current{nullptr};
+
+	// of the pass being recorded
+	uint32_t m_pass{0};
+	size_t m_passMarker{0};
+	uint32_t m_lastQuery{0};
+	uint32_t m_batchDraws{0};
+
+	std::vector<uint64_t> m_results;
+	std::vector<Span> m_spans;
+
+	bool createPool();
+
+	uint32_t writeTimestamp(VkCommandBuffer);
+
+	std::optional<FrameTime> readBack(FrameSet&);
+};
+
+}  // namespace etna
@@ -0,0 +1,136 @@
+#include <algorithm>
+#include <filesystem>
+#include <iostream>
+#include "y3.hpp"
+
+namespace fs = std::filesystem;
+using namespace etna;
+
+// while a module is reloaded, its scripts give their hooks to the live scripts of
+// the same name instead of being new scripts, so the nodes keep their transforms
+// and the scripts keep their data
+ScriptHandle y3::registerScript(ScriptHandle script) {
+	std::weak_ptr<Script>& named = m_namedScripts[script->m_info.name];
+	ScriptHandle live = named.lock();
+
+	if (live != nullptr && !m_reloadSource.empty() &&
+		live->m_info.source == m_reloadSource &&
+		script->m_info.source == m_reloadSource) {
+		live->reload(script->m_info);
+		m_reloadedScripts++;
+
+		return live;
+	}
+
+	named = script;
+
+	// every script, for the profiler, freed ones are dropped as the list doubles
+	if (m_scripts.size() >= 2 * m_liveScripts) {
+		std::erase_if(m_scripts, [](const auto& weak) { return weak.expired(); });
+		m_liveScripts = std::max<size_t>(m_scripts.size(), 64);
+	}
+
+	m_scripts.push_back(script);
+
+	return script;
+}
+
+void y3::watch(const std::string& dir) {
+	m_watcher = std::make_unique<FileWatcher>(dir);
+
+	if (!m_watcher->isValid()) {
+		std::cerr << "Warning: can't watch " << dir << ", hot reload is off"
+				  << std::endl;
+		m_watcher.reset();
+		return;
+	}
+
+	std::cout << "Watching " << dir << " for changed modules" << std::endl;
+}
+
+// Note: only modules are reloaded, a changed scene file needs the scene to be
+// destroyed and loaded again
+void y3::updateHotReload() {
+	if (m_watcher == nullptr) {
+		return;
+	}
+
+	const std::vector<std::string> paths = m_watcher->poll();
+
+	if (paths.empty()) {
+		return;
+	}
+
+	sol::table package = m_lua["package"];
+	sol::table loaded = package["loaded"];
+	sol::protected_function searchPath = package["searchpath"];
+	const std::string luaPath = package["path"];
+
+	// modules are found from their name again, the way require found them
+	std::vector<std::pair<std::string, std::string>> modules;
+
+	for (const auto& [key, _] : loaded) {
+		if (!key.is<std::string>()) {
+			continue;
+		}
+
+		const std::string module = key.as<std::string>();
+		sol::optional<std::string> modulePath = searchPath(module, luaPath);
+
+		if (modulePath) {
+			modules.emplace_back(module, *modulePath);
+		}
+	}
+
+	for (const std::string& path : paths) {
+		for (const auto& [module, modulePath] : modules) {
+			std::error_code error;
+
+			if (fs::equivalent(path, modulePath, error)) {
+				reloadModule(module, modulePath);
+			}
+		}
+	}
+}
+
+// PONDER: nodes the module returns are thrown away, factories only apply to the
+// nodes they make from now on
+void y3::reloadModule(const std::string& module, const std::string& path) {
+	const auto start = Clock::now();
+
+	sol::table loaded = m_lua["package"]["loaded"];
+	sol::object previous = loaded[module];
+	loaded[module] = sol::lua_nil;
+
+	// require names the chunk after the path searchpath gave
+	m_reloadSource = "@" + path;
+	m_reloadedScripts = 0;
+
+	// the module subscribes its keys again as it runs
+	const std::vector<InputDispatcher::Id> subscriptions =
+		m_input.getSubscriptions(m_reloadSource);
+
+	sol::protected_function require = m_lua["require"];
+	sol::protected_function_result result = require(module);
+
+	m_reloadSource.clear();
+
+	if (!result.valid()) {
+		sol::error err = result;
+		std::cerr << "Error in hot reload of " << module << ": " << err.what()
+				  << std::endl;
+
+		// keep the previous version for the next require
+		loaded[module] = previous;
+		return;
+	}
+
+	for (InputDispatcher::Id id : subscriptions) {
+		m_input.unsubscribe(id);
+	}
+
+	const std::chrono::duration<float, std::milli> time = Clock::now() - start;
+
+	std::cout << "Reloaded " << module << ": " << m_reloadedScripts
+			  << " scripts in " << time.count() << " ms" << std::endl;
+}
@@ -0,0 +1,128 @@
+#include <algorithm>
+#include <iostream>
+#include "input.hpp"
+
+using namespace etna;
+
+void InputDispatcher::update(const Window& window) {
+	update(sample(window));
+}
+
+InputSnapshot InputDispatcher::sample(const Window& window) {
+	InputSnapshot sample;
+
+	for (int key = KEY_SPACE; key <= KEY_MENU; key++) {
+		sample.down[key] = window.isKeyPressed(static_cast<Key>(key));
+	}
+
+	sample.mouseX = window.getMouseX();
+	sample.mouseY = window.getMouseY();
+	sample.mouseDeltaX = window.mouseDeltaX();
+	sample.mouseDeltaY = window.mouseDeltaY();
+
+	return sample;
+}
+
+void InputDispatcher::update(const InputSnapshot& sample) {
+	const auto previous = m_snapshot.down;
+
+	m_snapshot.down = sample.down;
+	m_snapshot.pressed |= m_snapshot.down & ~previous;
+	m_snapshot.released |= previous & ~m_snapshot.down;
+
+	m_snapshot.mouseX = sample.mouseX;
+	m_snapshot.mouseY = sample.mouseY;
+	m_snapshot.mouseDeltaX += sample.mouseDeltaX;
+	m_snapshot.mouseDeltaY += sample.mouseDeltaY;
+}
+
+void InputDispatcher::consume() {
+	m_snapshot.pressed.reset();
+	m_snapshot.released.reset();
+	m_snapshot.mouseDeltaX = 0;
+	m_snapshot.mouseDeltaY = 0;
+}
+
+void InputDispatcher::dispatch() {
+	if (m_snapshot.pressed.none() && m_snapshot.released.none() &&
+		!(m_hasDownSubscriptions && m_snapshot.down.any())) {
+		return;
+	}
+
+	// callbacks can subscribe more keys, which will be dispatched from next frame
+	const size_t count = m_subscriptions.size();
+
+	for (size_t i = 0; i < count; i++) {
+		const Subscription& subscription = m_subscriptions[i];
+
+		bool triggered = false;
+
+		switch (subscription.event) {
+			case KeyEvent::PRESS:
+				triggered = m_snapshot.isPressed(subscription.key);
+				break;
+			case KeyEvent::RELEASE:
+				triggered = m_snapshot.isReleased(subscription.key);
+				break;
+			case KeyEvent::DOWN:
+				triggered = m_snapshot.isDown(subscription.key);
+				break;
+		}
+
+		if (!triggered || !subscription.callback.valid()) {
+			continue;
+		}
+
+		// copy: the callback may unsubscribe itself
+		sol::protected_function callback = subscription.callback;
+
+		sol::protected_function_result result = callback(subscription.key);
+
+		if (!result.valid()) {
+			sol::error err = result;
+			std::cerr << "Error in key callback: " << err.what() << std::endl;
+		}
+	}
+
+	std::erase_if(m_subscriptions, [](const Subscription& subscription) {
+		return !subscription.callback.valid();
+	});
+}
+
+InputDispatcher::Id InputDispatcher::subscribe(int key,
+											   KeyEvent event,
+											   sol::protected_function callback,
+											   const std::string& source) {
+	if (!InputSnapshot::isValid(key)) {
+		throw std::runtime_error{"on_key: invalid key " + std::to_string(key)};
+	}
+
+	const Id id = m_nextId++;
+
+	m_subscriptions.push_back({id, key, event, callback, source});
+	m_hasDownSubscriptions |= event == KeyEvent::DOWN;
+
+	return id;
+}
+
+void InputDispatcher::unsubscribe(Id id) {
+	// just invalidate: we may be dispatching
+	for (auto& subscription : m_subscriptions) {
+		if (subscription.id == id) {
+			subscription.callback = sol::lua_nil;
+		}
+	}
+}
+
+std::vector<InputDispatcher::Id> InputDispatcher::getSubscriptions(
+	const std::string& source) const {
+	std::vector<Id> ids;
+
+	for (const auto& subscription : m_subscriptions) {
+		if (subscription.source == source && subscription.callback.valid()) {
+			ids.push_back(subscription.id);
+		}
+	}
+
+	return ids;
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <bitset>
+#include "etna/window.hpp"
+#include "sol.hpp"
+
+namespace etna {
+
+struct InputSnapshot {
+	static constexpr uint32_t KEY_COUNT = KEY_MENU + 1;
+
+	std::bitset<KEY_COUNT> down;
+	std::bitset<KEY_COUNT> pressed;
+	std::bitset<KEY_COUNT> released;
+
+	double mouseX{0};
+	double mouseY{0};
+	double mouseDeltaX{0};
+	double mouseDeltaY{0};
+
+	static bool isValid(int key) { return key >= KEY_SPACE && key <= KEY_MENU; }
+
+	bool isDown(int key) const { return isValid(key) && down[key]; }
+
+	bool isPressed(int key) const { return isValid(key) && pressed[key]; }
+
+	bool isReleased(int key) const { return isValid(key) && released[key]; }
+};
+
+// Note 1: the window is sampled once per frame, then subscriptions are dispatched
+// from the snapshot and polling scripts read it without going through the window
+// Note 2: edges and mouse deltas add up until a simulation step consumes them, so
+// with the fixed loop a step sees them once whatever the number of steps per frame
+class InputDispatcher {
+public:
+	using Id = uint32_t;
+
+	enum class KeyEvent {
+		PRESS,
+		RELEASE,
+		DOWN,
+	};
+
+	void update(const Window&);
+
+	// keys down and mouse of the window, without edges
+	static InputSnapshot sample(const Window&);
+
+	// from the keys down and the mouse of a sample, e.g. a recorded frame
+	void update(const InputSnapshot& sample);
+
+	void dispatch();
+
+	// after a step, clears the edges and the mouse deltas it has seen
+	void consume();
+
+	// source is the chunk the callback comes from, e.g. "@path" of a module
+	Id subscribe(int key,
+				 KeyEvent,
+				 sol::protected_function,
+				 const std::string& source = "");
+
+	void unsubscribe(Id);
+
+	std::vector<Id> getSubscriptions(const std::string& source) const;
+
+	const InputSnapshot& getSnapshot() const { return m_snapshot; }
+
+private:
+	struct Subscription {
+		Id id;
+		int key;
+		KeyEvent event;
+		sol::protected_function callback;
+		std::string source;
+	};
+
+	InputSnapshot m_snapshot;
+	std::vector<Subscription> m_subscriptions;
+	bool m_hasDownSubscriptions{false};
+	Id m_nextId{1};
+};
+
+}  // namespace etna
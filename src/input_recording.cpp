@@ -0,0 +1,133 @@
+#include <cstring>
+#include <stdexcept>
+#include "input_recording.hpp"
+#include "mapped_file.hpp"
+
+using namespace etna;
+
+namespace {
+
+struct Header {
+	char magic[4];
+	uint32_t version;
+	uint32_t keyCount;
+	int64_t seed;
+};
+
+constexpr char MAGIC[4] = {'Y', '3', 'I', 'N'};
+constexpr uint32_t VERSION = 1;
+constexpr size_t KEY_BYTES = (InputSnapshot::KEY_COUNT + 7) / 8;
+
+// dt, keys down as bits, then the mouse
+constexpr size_t FRAME_SIZE = sizeof(float) + KEY_BYTES + 4 * sizeof(double);
+
+}  // namespace
+
+void InputRecording::record(const std::string& path, int64_t seed) {
+	stop();
+
+	m_file.open(path, std::ios::binary | std::ios::trunc);
+
+	if (!m_file) {
+		throw std::runtime_error{"Can't write input recording " + path};
+	}
+
+	Header header{
+		.version = VERSION,
+		.keyCount = InputSnapshot::KEY_COUNT,
+		.seed = seed,
+	};
+
+	std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+
+	m_file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+	m_mode = Mode::RECORD;
+	m_frame = 0;
+}
+
+int64_t InputRecording::replay(const std::string& path) {
+	stop();
+
+	MappedFile file{path};
+
+	if (!file.isValid() || file.getSize() < sizeof(Header)) {
+		throw std::runtime_error{"Can't read input recording " + path};
+	}
+
+	Header header;
+	std::memcpy(&header, file.getData(), sizeof(header));
+
+	if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 ||
+		header.version != VERSION ||
+		header.keyCount != InputSnapshot::KEY_COUNT) {
+		throw std::runtime_error{"Incompatible input recording " + path};
+	}
+
+	const size_t count = (file.getSize() - sizeof(Header)) / FRAME_SIZE;
+	const char* data = file.getData() + sizeof(Header);
+
+	m_frames.resize(count);
+
+	for (Frame& frame : m_frames) {
+		std::memcpy(&frame.dt, data, sizeof(float));
+		data += sizeof(float);
+
+		for (size_t key = 0; key < InputSnapshot::KEY_COUNT; key++) {
+			frame.down[key] = (data[key / 8] >> (key % 8)) & 1;
+		}
+
+		data += KEY_BYTES;
+
+		for (double* value : {&frame.mouseX, &frame.mouseY, &frame.mouseDeltaX,
+							  &frame.mouseDeltaY}) {
+			std::memcpy(value, data, sizeof(double));
+			data += sizeof(double);
+		}
+	}
+
+	m_mode = Mode::REPLAY;
+	m_frame = 0;
+
+	return header.seed;
+}
+
+void InputRecording::stop() {
+	if (m_mode == Mode::RECORD) {
+		m_file.close();
+	}
+
+	m_mode = Mode::OFF;
+	m_frames.clear();
+}
+
+void InputRecording::write(float dt, const InputSnapshot& snapshot) {
+	char frame[FRAME_SIZE]{};
+	char* data = frame;
+
+	std::memcpy(data, &dt, sizeof(float));
+	data += sizeof(float);
+
+	for (size_t key = 0; key < InputSnapshot::KEY_COUNT; key++) {
+		data[key / 8] |= static_cast<char>(snapshot.down[key] << (key % 8));
+	}
+
+	data += KEY_BYTES;
+
+	for (double value : {snapshot.mouseX, snapshot.mouseY, snapshot.mouseDeltaX,
+						 snapshot.mouseDeltaY}) {
+		std::memcpy(data, &value, sizeof(double));
+		data += sizeof(double);
+	}
+
+	m_file.write(frame, FRAME_SIZE);
+	m_frame++;
+}
+
+const InputRecording::Frame* InputRecording::read() {
+	if (m_frame >= m_frames.size()) {
+		return nullptr;
+	}
+
+	return &m_frames[m_frame++];
+}
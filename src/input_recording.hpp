@@ -0,0 +1,58 @@
+#pragma once
+
+#include <fstream>
+#include <string>
+#include <vector>
+#include "input.hpp"
+
+namespace etna {
+
+// Input and delta time of every frame, written to a file and played back so that
+// interactive scenes run the same way on every replay
+// Note 1: a frame holds the keys down, the mouse and dt, pressed and released
+// keys follow from the keys down of the previous frame
+// Note 2: the seed of math.random is stored in the header, the rest of the
+// randomness (e.g. os.time) isn't replayed
+class InputRecording {
+public:
+	enum class Mode {
+		OFF,
+		RECORD,
+		REPLAY,
+	};
+
+	struct Frame {
+		float dt{0};
+		std::bitset<InputSnapshot::KEY_COUNT> down;
+		double mouseX{0};
+		double mouseY{0};
+		double mouseDeltaX{0};
+		double mouseDeltaY{0};
+	};
+
+	void record(const std::string& path, int64_t seed);
+
+	// the whole file is read up front, returns the seed it was recorded with
+	int64_t replay(const std::string& path);
+
+	void stop();
+
+	Mode getMode() const { return m_mode; }
+
+	void write(float dt, const InputSnapshot&);
+
+	// nullptr once the replay is over
+	const Frame* read();
+
+	uint64_t getFrame() const { return m_frame; }
+
+	uint64_t getFrameCount() const { return m_frames.size(); }
+
+private:
+	Mode m_mode{Mode::OFF};
+	std::ofstream m_file;
+	std::vector<Frame> m_frames;
+	uint64_t m_frame{0};
+};
+
+}  // namespace etna
@@ -0,0 +1,133 @@
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include "lua_allocator.hpp"
+
+using namespace etna;
+
+bool LuaAllocator::g_pooling = false;
+
+LuaAllocator::LuaAllocator() : m_pooling{g_pooling} {
+	m_stats.pooling = m_pooling;
+}
+
+LuaAllocator::~LuaAllocator() {
+	for (void* arena : m_arenas) {
+		std::free(arena);
+	}
+}
+
+void* LuaAllocator::allocate(void* ud, void* ptr, size_t oldSize, size_t newSize) {
+	auto* self = static_cast<LuaAllocator*>(ud);
+	Stats& stats = self->m_stats;
+
+	// Note: when ptr is null oldSize is the type of the object, not a size
+	if (ptr == nullptr) {
+		oldSize = 0;
+	}
+
+	if (newSize == 0) {
+		if (ptr != nullptr) {
+			self->freeBlock(ptr, oldSize);
+
+			stats.frees++;
+			stats.liveBytes -= oldSize;
+			stats.classes[getClass(oldSize)].liveBytes -= oldSize;
+		}
+
+		return nullptr;
+	}
+
+	void* block = nullptr;
+
+	if (ptr == nullptr) {
+		block = self->allocateBlock(newSize);
+	} else if (!self->m_pooling ||
+			   (oldSize > MAX_POOLED && newSize > MAX_POOLED)) {
+		block = std::realloc(ptr, newSize);
+	} else if (getClass(oldSize) == getClass(newSize)) {
+		block = ptr;
+	} else {
+		block = self->allocateBlock(newSize);
+
+		if (block != nullptr) {
+			std::memcpy(block, ptr, std::min(oldSize, newSize));
+			self->freeBlock(ptr, oldSize);
+		}
+	}
+
+	// lua keeps the old block when this fails
+	if (block == nullptr) {
+		return nullptr;
+	}
+
+	if (ptr != nullptr) {
+		stats.liveBytes -= oldSize;
+		stats.classes[getClass(oldSize)].liveBytes -= oldSize;
+	}
+
+	ClassStats& sizeClass = stats.classes[getClass(newSize)];
+	sizeClass.allocations++;
+	sizeClass.liveBytes += newSize;
+
+	stats.allocations++;
+	stats.liveBytes += newSize;
+
+	return block;
+}
+
+void LuaAllocator::endFrame() {
+	m_stats.frameAllocations = m_stats.allocations - m_frameStart;
+	m_frameStart = m_stats.allocations;
+}
+
+LuaAllocator::Stats LuaAllocator::getStats() const {
+	return m_stats;
+}
+
+void* LuaAllocator::allocateBlock(size_t size) {
+	const size_t sizeClass = getClass(size);
+
+	if (!m_pooling || sizeClass == CLASS_COUNT) {
+		return std::malloc(size);
+	}
+
+	if (FreeBlock* block = m_freeLists[sizeClass]; block != nullptr) {
+		m_freeLists[sizeClass] = block->next;
+		return block;
+	}
+
+	const size_t blockSize = (sizeClass + 1) * GRANULARITY;
+
+	// Note: the tail of a full arena is left unused, it's under MAX_POOLED bytes
+	if (static_cast<size_t>(m_arenaEnd - m_arenaNext) < blockSize) {
+		auto* arena = static_cast<char*>(std::malloc(ARENA_SIZE));
+
+		if (arena == nullptr) {
+			return nullptr;
+		}
+
+		m_arenas.push_back(arena);
+		m_arenaNext = arena;
+		m_arenaEnd = arena + ARENA_SIZE;
+		m_stats.arenaBytes += ARENA_SIZE;
+	}
+
+	void* block = m_arenaNext;
+	m_arenaNext += blockSize;
+
+	return block;
+}
+
+void LuaAllocator::freeBlock(void* ptr, size_t size) {
+	const size_t sizeClass = getClass(size);
+
+	if (!m_pooling || sizeClass == CLASS_COUNT) {
+		std::free(ptr);
+		return;
+	}
+
+	auto* block = static_cast<FreeBlock*>(ptr);
+	block->next = m_freeLists[sizeClass];
+	m_freeLists[sizeClass] = block;
+}
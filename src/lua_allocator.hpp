@@ -0,0 +1,86 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace etna {
+
+// lua_Alloc for the main Lua state, counting what Lua allocates. With pooling,
+// blocks up to MAX_POOLED bytes come from free lists of size classes, carved out
+// of ARENA_SIZE arenas, instead of malloc
+// Note 1: lua passes the old size of a block back, so blocks have no header and
+// are freed to the class of their size
+// Note 2: arenas are only given back when the state is gone, a heap that shrinks
+// keeps its blocks in the free lists
+// Note 3: a state and its allocator are used by one thread at a time
+class LuaAllocator {
+public:
+	static constexpr size_t GRANULARITY = 16;
+	static constexpr size_t MAX_POOLED = 256;
+	static constexpr size_t CLASS_COUNT = MAX_POOLED / GRANULARITY;
+	static constexpr size_t ARENA_SIZE = 64 * 1024;
+
+	// read when an allocator is made, e.g. from --lua-pool
+	static bool g_pooling;
+
+	// the last class is for the blocks over MAX_POOLED, from malloc
+	struct ClassStats {
+		uint64_t allocations{0};
+		size_t liveBytes{0};
+	};
+
+	struct Stats {
+		bool pooling{false};
+		uint64_t allocations{0};
+		uint64_t frees{0};
+		uint64_t frameAllocations{0};  // during the last frame
+		size_t liveBytes{0};
+		size_t arenaBytes{0};
+		std::array<ClassStats, CLASS_COUNT + 1> classes;
+	};
+
+	LuaAllocator();
+
+	~LuaAllocator();
+
+	// a lua_Alloc, the allocator is its user data
+	static void* allocate(void* ud, void* ptr, size_t oldSize, size_t newSize);
+
+	// for the allocations per frame
+	void endFrame();
+
+	Stats getStats() const;
+
+private:
+	struct FreeBlock {
+		FreeBlock* next;
+	};
+
+	bool m_pooling;
+
+	std::array<FreeBlock*, CLASS_COUNT> m_freeLists{};
+	std::vector<void*> m_arenas;
+	char* m_arenaNext{nullptr};
+	char* m_arenaEnd{nullptr};
+
+	Stats m_stats;
+	uint64_t m_frameStart{0};
+
+	static size_t getClass(size_t size) {
+		return size > MAX_POOLED ? CLASS_COUNT : (size - 1) / GRANULARITY;
+	}
+
+	void* allocateBlock(size_t size);
+
+	void freeBlock(void* ptr, size_t size);
+
+public:
+	LuaAllocator(const LuaAllocator&) = delete;
+	LuaAllocator& operator=(const LuaAllocator&) = delete;
+	LuaAllocator(LuaAllocator&&) = delete;
+	LuaAllocator& operator=(LuaAllocator&&) = delete;
+};
+
+}  // namespace etna
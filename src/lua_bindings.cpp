@@ -1,3 +1,6 @@
+#include "pipeline_cache.hpp"
+#include "stress.hpp"
+#include "trace.hpp"
 #include "y3.hpp"
 
 using namespace etna;
@@ -44,14 +47,59 @@ static std::vector<ScriptHandle> getScripts(sol::table params) {
 	return {};
 }
 
+static int writeChunk(lua_State*, const void* p, size_t size, void* code) {
+	static_cast<std::string*>(code)->append(static_cast<const char*>(p), size);
+	return 0;
+}
+
+// parallel scripts run in other lua states, so their update is moved as bytecode
+static std::string dumpFunction(const std::string& name, sol::function fn) {
+	lua_State* L = fn.lua_state();
+	std::string code;
+
+	fn.push();
+
+	for (int i = 1; const char* upvalue = lua_getupvalue(L, -1, i); i++) {
+		if (std::string(upvalue) != "_ENV") {
+			std::cerr << "Warning: parallel script " << name << " captures '"
+					  << upvalue << "', which workers see as nil" << std::endl;
+		}
+
+		lua_pop(L, 1);
+	}
+
+	const int result = lua_dump(L, writeChunk, &code, 0);
+
+	lua_pop(L, 1);
+
+	if (result != 0 || code.empty()) {
+		throw std::runtime_error{"Failed to dump update of parallel script " + name};
+	}
+
+	return code;
+}
+
+// chunk name of a function, "@path" for files
+static std::string getSource(sol::function fn) {
+	lua_State* L = fn.lua_state();
+	lua_Debug ar;
+
+	fn.push();
+	lua_getinfo(L, ">S", &ar);
+
+	return ar.source;
+}
+
 ScriptHandle create_script(sol::table scriptTable) {
 	sol::function update = scriptTable["update"];
+	sol::function fixedUpdate = scriptTable["fixed_update"];
 	sol::function start = scriptTable["start"];
 	sol::function sleep = scriptTable["sleep"];
 	sol::function destroy = scriptTable["destroy"];
 
 	Script::HookFunc onCreate;
 	Script::UpdateFunc onUpdate;
+	Script::UpdateFunc onFixedUpdate;
 	Script::HookFunc onSleep;
 	Script::HookFunc onDestroy;
 
@@ -66,6 +114,18 @@ ScriptHandle create_script(sol::table scriptTable) {
 		};
 	}
 
+	if (fixedUpdate.valid()) {
+		onFixedUpdate = [fixedUpdate](float dt, _SceneNode* node, sol::table data,
+									  Scene* scene) {
+			sol::protected_function_result result =
+				fixedUpdate(dt, node, data, scene);
+			if (!result.valid()) {
+				sol::error err = result;
+				std::cerr << "Error in fixed_update: " << err.what() << std::endl;
+			}
+		};
+	}
+
 	if (start.valid()) {
 		onCreate = [start](_SceneNode* node, sol::table data, Scene* scene) {
 			sol::protected_function_result result = start(node, data, scene);
@@ -96,13 +156,31 @@ ScriptHandle create_script(sol::table scriptTable) {
 		};
 	}
 
+	const std::string name = scriptTable["name"];
+	const bool parallel = scriptTable.get_or("parallel", false);
+
+	std::string source;
+
+	for (const sol::function& hook : {update, fixedUpdate, start, sleep, destroy}) {
+		if (hook.valid()) {
+			source = getSource(hook);
+			break;
+		}
+	}
+
 	const Script::CreateInfo info{
-		.name = scriptTable["name"],
+		.name = name,
 		.onUpdate = onUpdate,
+		.onFixedUpdate = onFixedUpdate,
 		.onStart = onCreate,
 		.onSleep = onSleep,
 		.onDestroy = onDestroy,
 		.data = scriptTable["data"].get_or(sol::table()),
+		.rate = scriptTable.get_or("rate", 0.0f),
+		.every = scriptTable.get_or("every", 0u),
+		.parallel = parallel && update.valid(),
+		.parallelCode = parallel && update.valid() ? dumpFunction(name, update) : "",
+		.source = source,
 	};
 
 	return std::make_shared<Script>(info);
@@ -120,11 +198,11 @@ SceneNode create_mesh(sol::table params) {
 	return scene::createMeshNode(info);
 }
 
-SceneNode create_camera(sol::table params) {
+static scene::CameraNodeCreateInfo getCameraInfo(sol::table params) {
 	Camera::CreateInfo defaultCameraInfo{};
 	Viewport defaultViewport{};
 
-	scene::CameraNodeCreateInfo info{
+	return {
 		.name = params["name"],
 		.cameraInfo = params["cameraInfo"].get_or(defaultCameraInfo),
 		.viewport = params["viewport"].get_or(defaultViewport),
@@ -132,125 +210,63 @@ SceneNode create_camera(sol::table params) {
 		.transform = getTransform(params),
 		.scripts = getScripts(params),
 	};
-
-	return scene::createCameraNode(info);
-}
-
-MaterialHandle create_grid_material(sol::table params) {
-	Color defaultColor{WHITE};
-	Color defaultGridColor{BLACK};
-
-	engine::GridMaterialParams gridParams{
-		.color = params["color"].get_or(defaultColor),
-		.gridColor = params["gridColor"].get_or(defaultGridColor),
-		.gridSpacing = params["gridSpacing"].get_or(1.0f),
-		.thickness = params["thickness"].get_or(0.1f),
-	};
-
-	return engine::createGridMaterial(gridParams);
 }
 
-// TEMP: transparent materials will be better handled in the future
-MaterialHandle create_grid_material_transparent(sol::table params) {
-	Color defaultColor{WHITE};
-	Color defaultGridColor{BLACK};
-
-	engine::GridMaterialParams gridParams{
-		.color = params["color"].get_or(defaultColor),
-		.gridColor = params["gridColor"].get_or(defaultGridColor),
-		.gridSpacing = params["gridSpacing"].get_or(1.0f),
-		.thickness = params["thickness"].get_or(0.1f),
-	};
-
-	return engine::createTransparentGridMaterial(gridParams);
-}
-//
+static y3::GcSettings readGcSettings(sol::table params,
+									 const y3::GcSettings& current) {
+	y3::GcSettings settings = current;
 
-MaterialTemplateHandle create_material_template(sol::table params) {
-	std::vector<RawShader> rawShaders;
-	std::vector<std::string> shaders;
+	if (params["mode"].valid()) {
+		const std::string mode = params["mode"];
 
-	if (params["shaders"].is<sol::table>()) {
-		sol::table shaderTable = params["shaders"];
-
-		for (const auto& kv : shaderTable) {
-			sol::object value = kv.second;
-
-			if (value.is<RawShader>()) {
-				rawShaders.push_back(value.as<RawShader>());
-			} else if (value.is<std::string>()) {
-				shaders.push_back(value.as<std::string>());
-			}
+		if (mode == "auto") {
+			settings.mode = y3::GcSettings::Mode::AUTO;
+		} else if (mode == "incremental") {
+			settings.mode = y3::GcSettings::Mode::INCREMENTAL;
+		} else if (mode == "generational") {
+			settings.mode = y3::GcSettings::Mode::GENERATIONAL;
+		} else {
+			throw std::runtime_error{"gc_config: unknown mode " + mode};
 		}
 	}
 
-	const MaterialTemplate::CreateInfo info{
-		.shaders = shaders,
-		.rawShaders = rawShaders,
-		.enableDepth = params["enableDepth"].get_or(true),
-		.transparency = params["transparency"].get_or(false),
-		.polygonMode = params["polygonMode"].get_or(VK_POLYGON_MODE_FILL),
-		.lineWidth = params["lineWidth"].get_or(1.0f),
-		.samples = params["samples"].get_or(0u),
-	};
+	if (params["target_fps"].valid()) {
+		settings.targetFrameTime = 1.f / params["target_fps"].get<float>();
+	}
 
-	return MaterialTemplate::create(info);
-}
+	settings.minStepTime =
+		params.get_or("min_ms", current.minStepTime * 1000) / 1000;
+	settings.maxStepTime =
+		params.get_or("max_ms", current.maxStepTime * 1000) / 1000;
+	settings.stepSize = params.get_or("step_kb", current.stepSize);
+	settings.pause = params.get_or("pause", current.pause);
+	settings.minorMultiplier =
+		params.get_or("minor_multiplier", current.minorMultiplier);
 
-template <typename T>
-static void append_bytes(std::vector<uint8_t>& buf, const T& v) {
-	const uint8_t* p = reinterpret_cast<const uint8_t*>(&v);
-	buf.insert(buf.end(), p, p + sizeof(T));
+	return settings;
 }
 
-MaterialHandle create_material(sol::table params) {
-	sol::object raw = params["params"];
-	if (!raw.valid() || raw.get_type() != sol::type::table) {
-		throw std::runtime_error{
-			"create_material: expected params.params to be a table"};
-	}
+static y3::LoopSettings readLoopSettings(sol::table params,
+										 const y3::LoopSettings& current) {
+	y3::LoopSettings settings = current;
+
+	if (params["mode"].valid()) {
+		const std::string mode = params["mode"];
 
-	sol::table list = raw.as<sol::table>();
-	std::vector<uint8_t> buf;
-
-	for (const auto& kv : raw.as<sol::table>()) {
-		sol::object v = kv.second;
-
-		if (v.is<float>()) {
-			append_bytes(buf, v.as<float>());
-		} else if (v.is<int>()) {
-			append_bytes(buf, v.as<int>());
-		} else if (v.is<bool>()) {
-			buf.push_back(v.as<bool>() ? 1 : 0);
-		} else if (v.is<Vec3>()) {
-			Vec3 vec = v.as<Vec3>();
-			append_bytes(buf, vec[0]);
-			append_bytes(buf, vec[1]);
-			append_bytes(buf, vec[2]);
-		} else if (v.is<Vec4>()) {
-			Vec4 vec = v.as<Vec4>();
-			append_bytes(buf, vec[0]);
-			append_bytes(buf, vec[1]);
-			append_bytes(buf, vec[2]);
-			append_bytes(buf, vec[3]);
-		} else if (v.is<Color>()) {
-			Color c = v.as<Color>();
-			append_bytes(buf, c.r);
-			append_bytes(buf, c.g);
-			append_bytes(buf, c.b);
-			append_bytes(buf, c.a);
+		if (mode == "variable") {
+			settings.mode = y3::LoopSettings::Mode::VARIABLE;
+		} else if (mode == "fixed") {
+			settings.mode = y3::LoopSettings::Mode::FIXED;
 		} else {
-			throw std::runtime_error{"Unsupported param type in material params"};
+			throw std::runtime_error{"loop_config: unknown mode " + mode};
 		}
 	}
 
-	Material::CreateInfo info{
-		.templateHandle = params["template"],
-		.paramsSize = buf.size(),
-		.params = buf.data(),
-	};
+	settings.interpolate = params.get_or("interpolate", current.interpolate);
+	settings.maxFps = params.get_or("max_fps", current.maxFps);
+	settings.spinTime = params.get_or("spin_ms", current.spinTime * 1000) / 1000;
 
-	return Material::create(info);
+	return settings;
 }
 
 void y3::initLuaBindings() {
@@ -271,11 +287,112 @@ void y3::initLuaBindings() {
 		destroyScene(sceneName);
 	});
 
+	// budget in megabytes of GPU and Lua memory, sleeping scenes are evicted
+	// over it, 0 for no budget
+	y3_table.set_function("scene_budget", [this](float budget) {
+		setSceneBudget(static_cast<size_t>(std::max(budget, 0.f) * 1024 * 1024));
+	});
+
+	y3_table.set_function("scene_memory", [this]() { return getSceneMemory(); });
+
+	// budget in milliseconds of main thread time per frame
+	y3_table.set_function("preload_scene", [this](const std::string& sceneName,
+												  sol::optional<float> budget) {
+		preloadScene(sceneName, budget.value_or(2.f) / 1000.f);
+	});
+
+	y3_table.set_function("preload_progress", [this](const std::string& sceneName) {
+		static constexpr const char* STATES[] = {"none", "reading", "loading",
+												 "ready"};
+
+		const PreloadStatus status = getPreloadStatus(sceneName);
+
+		return m_lua.create_table_with(
+			"state", STATES[static_cast<int>(status.state)],	   //
+			"ready", status.state == PreloadStatus::State::READY,  //
+			"slices", status.slices,							   //
+			"time_ms", status.loadTime * 1000.f);
+	});
+
+	// timing
+	y3_table.set_function("set_fixed_timestep",
+						  [this](float seconds) { m_fixedTimestep = seconds; });
+
+	y3_table.set_function("get_fixed_timestep",
+						  [this]() { return m_fixedTimestep; });
+
+	// fixed steps for every script, interpolated renders and a frame limiter
+	y3_table.set_function("loop_config", [this](sol::table params) {
+		setLoopSettings(readLoopSettings(params, getLoopSettings()));
+	});
+
+	// coroutines
+	y3_table.set_function("spawn", [this](sol::function fn) {
+		return m_coroutines.spawn(m_lua, fn);
+	});
+
+	y3_table.set_function("cancel", [this](CoroutineScheduler::Id id) {
+		m_coroutines.cancel(id);
+	});
+
+	y3_table.set_function("wait", sol::yielding([this](float seconds) {
+							  m_coroutines.waitSeconds(seconds);
+						  }));
+
+	y3_table.set_function("wait_frames", sol::yielding([this](uint32_t frames) {
+							  m_coroutines.waitFrames(frames);
+						  }));
+
+	y3_table.set_function("wait_until",
+						  sol::yielding([this](const std::string& event) {
+							  m_coroutines.waitEvent(event);
+						  }));
+
+	y3_table.set_function("signal", [this](const std::string& event) {
+		m_coroutines.signal(event);
+	});
+
+	// garbage collection
+	y3_table.set_function("gc_config", [this](sol::table params) {
+		setGcSettings(readGcSettings(params, getGcSettings()));
+	});
+
+	y3_table.set_function("gc_stats", [this]() {
+		const GcStats& stats = getGcStats();
+
+		return m_lua.create_table_with(
+			"time_ms", stats.stepTime * 1000,						 //
+			"heap_kb", static_cast<double>(stats.heapSize) / 1024,  //
+			"steps", stats.steps,									 //
+			"cycles", stats.cycles);
+	});
+
 	// scene graph
-	y3_table.set_function("create_script", &create_script);
-	y3_table.set_function("create_camera", &create_camera);
+	y3_table.set_function("create_script", [this](sol::table scriptTable) {
+		return registerScript(create_script(scriptTable));
+	});
+
+	y3_table.set_function("create_camera", [this](sol::table params) {
+		const scene::CameraNodeCreateInfo info = getCameraInfo(params);
+		CameraNode node = scene::createCameraNode(info);
+
+		m_cameraRecords[node.get()] = {node, info.cameraInfo, info.viewport};
+
+		return node;
+	});
 	y3_table.set_function("create_mesh", &create_mesh);
 
+	y3_table.set_function("create_light", [](sol::table params) {
+		DirectionalLight::CreateInfo defaultInfo{};
+
+		return scene::createLightNode({
+			.name = params["name"],
+			.direction = params.get_or("direction", defaultInfo.direction),
+			.intensity = params.get_or("intensity", defaultInfo.intensity),
+			.color = params.get_or("color", defaultInfo.color),
+		});
+	});
+
 	y3_table.set_function(
 		"create_root", sol::overload(
 						   [](const std::string& name) {
@@ -286,32 +403,198 @@ void y3::initLuaBindings() {
 						   }));
 
 	// materials
-	y3_table.set_function("create_material_template", &create_material_template);
-	y3_table.set_function("create_material", &create_material);
-	y3_table.set_function("create_grid_material", &create_grid_material);
+	y3_table.set_function("create_material_template", [this](sol::table params) {
+		return getMaterialTemplate(params);
+	});
+
+	y3_table.set_function("create_material",
+						  [this](sol::table params) { return getMaterial(params); });
+	y3_table.set_function("create_grid_material", [this](sol::table params) {
+		return getGridMaterial(params);
+	});
+
 	y3_table.set_function("create_grid_material_transparent",
-						  &create_grid_material_transparent);
-	y3_table.set_function("create_color_material", &engine::createColorMaterial);
-	y3_table.set_function("create_point_material", &engine::createPointMaterial);
+						  [this](sol::table params) {
+							  return getGridMaterial(params, true);
+						  });
+
+	y3_table.set_function("create_color_material",
+						  [this](sol::optional<Color> color) {
+							  return getColorMaterial(color.value_or(WHITE));
+						  });
+
+	y3_table.set_function("create_point_material",
+						  [this](sol::optional<Color> color) {
+							  return getColorMaterial(color.value_or(WHITE), true);
+						  });
 	y3_table.set_function("default_vert_shader", &engine::getDefaultVertShader);
 
 	// primitives
-	y3_table.set_function("get_sphere", engine::getSphere);
-	y3_table.set_function("get_cube", engine::getCube);
-	y3_table.set_function("get_pyramid", engine::getPyramid);
-	y3_table.set_function("get_quad", engine::getQuad);
-
-	// window
-	y3_table.set_function("is_key_down", [](int key) {
-		return g_window->isKeyPressed(static_cast<Key>(key));
+	y3_table.set_function("get_sphere", [this]() { return getPrimitive("sphere"); });
+	y3_table.set_function("get_cube", [this]() { return getPrimitive("cube"); });
+	y3_table.set_function("get_pyramid",
+						  [this]() { return getPrimitive("pyramid"); });
+	y3_table.set_function("get_quad", [this]() { return getPrimitive("quad"); });
+
+	// sized shapes, e.g. y3.sphere({radius = 0.5, precision = 16})
+	for (const char* shape : {"sphere", "brick", "cube", "quad", "pyramid"}) {
+		y3_table.set_function(shape,
+							  [this, shape](sol::optional<sol::table> params) {
+								  return getShape(
+									  shape, params.value_or(m_lua.create_table()));
+							  });
+	}
+
+	// OBJ and glTF binary files
+	y3_table.set_function("load_mesh", [this](const std::string& path) {
+		return loadMesh(path);
+	});
+
+	// assets
+	y3_table.set_function("get_asset", [this](const std::string& kind,
+											  sol::optional<sol::table> params) {
+		return getAsset(kind, params.value_or(m_lua.create_table()));
+	});
+
+	y3_table.set_function("asset_stats", [this]() { return getAssetStats(); });
+
+	y3_table.set_function("pipeline_stats", [this]() {
+		const pipeline_cache::Stats stats = pipeline_cache::getStats();
+
+		return m_lua.create_table_with(
+			"warm", stats.warm,											  //
+			"loaded_kb", static_cast<double>(stats.loadedBytes) / 1024,  //
+			"pipelines", stats.pipelines,								  //
+			"time_ms", stats.createTime * 1000);
+	});
+
+	// what's alive: GPU buffers by owner, device memory, nodes, Lua heap
+	y3_table.set_function("stats", [this]() { return getResourceStats(); });
+
+	// allocations of the Lua heap, per frame and by size class
+	y3_table.set_function("lua_alloc_stats",
+						  [this]() { return getLuaAllocStats(); });
+
+	// prints the stats every few seconds, 0 to stop
+	y3_table.set_function("stats_log",
+						  [this](float seconds) { setStatsLog(seconds); });
+
+	// Chrome trace, open the file in chrome://tracing or Perfetto
+	y3_table.set_function("trace_start", &trace::start);
+	y3_table.set_function("trace_stop", &trace::stop);
+
+	// synthetic scenes for load tests
+	y3_table["stress"] = stress::load(m_lua, y3_table);
+
+	// profiler
+	sol::table profiler = m_lua.create_table();
+	y3_table["profiler"] = profiler;
+
+	profiler.set_function("frame_stats", [this](sol::optional<uint32_t> frames) {
+		return getFrameStats(frames.value_or(FrameProfiler::FRAME_COUNT));
+	});
+
+	profiler.set_function("summary",
+						  [this](bool enabled) { m_profiler.setSummary(enabled); });
+
+	// timestamps around camera passes and draw batches, the frame stats get a gpu
+	// entry a few frames late
+	profiler.set_function("gpu", [this](bool enabled) {
+		m_gpuProfiler.setEnabled(enabled);
+	});
+
+	// of the last frame read back, in drawing order
+	profiler.set_function("gpu_passes", [this]() {
+		sol::table passes = m_lua.create_table();
+
+		for (const GpuProfiler::Span& span : m_gpuProfiler.getSpans()) {
+			passes.add(m_lua.create_table_with(
+				"name", span.name,			  //
+				"pass", span.pass + 1,		  //
+				"batch", span.batch,		  //
+				"draws", span.draws,		  //
+				"time_ms", span.time * 1000));
+		}
+
+		return passes;
+	});
+
+	// times every script hook, the top scripts are printed on exit
+	profiler.set_function("scripts",
+						  [](bool enabled) { Script::g_profiling = enabled; });
+
+	profiler.set_function("top_scripts", [this](sol::optional<size_t> count) {
+		sol::table top = m_lua.create_table();
+
+		for (const ScriptHandle& script : getTopScripts(count.value_or(10))) {
+			sol::table entry = m_lua.create_table_with(
+				"name", script->m_info.name,  //
+				"total_ms", script->getTotalTime() * 1000);
+
+			for (size_t i = 0; i < static_cast<size_t>(Script::Hook::COUNT); i++) {
+				const auto hook = static_cast<Script::Hook>(i);
+				const Script::HookStats& stats = script->getHookStats(hook);
+
+				entry[Script::getHookName(hook)] = m_lua.create_table_with(
+					"calls", stats.calls,			  //
+					"total_ms", stats.total * 1000,  //
+					"max_ms", stats.max * 1000);
+			}
+
+			top.add(entry);
+		}
+
+		return top;
+	});
+
+	// input
+	y3_table.set_function("is_key_down", [this](int key) {
+		return m_input.getSnapshot().isDown(key);
+	});
+
+	y3_table.set_function("key_clicked", [this](int key) {
+		return m_input.getSnapshot().isPressed(key);
+	});
+
+	y3_table.set_function("mouse_x",
+						  [this]() { return m_input.getSnapshot().mouseX; });
+	y3_table.set_function("mouse_y",
+						  [this]() { return m_input.getSnapshot().mouseY; });
+	y3_table.set_function("mouse_dx",
+						  [this]() { return m_input.getSnapshot().mouseDeltaX; });
+	y3_table.set_function("mouse_dy",
+						  [this]() { return m_input.getSnapshot().mouseDeltaY; });
+
+	y3_table.set_function("on_key", [this](int key, sol::protected_function callback,
+										   sol::optional<std::string> event) {
+		InputDispatcher::KeyEvent keyEvent = InputDispatcher::KeyEvent::PRESS;
+
+		if (event == "release") {
+			keyEvent = InputDispatcher::KeyEvent::RELEASE;
+		} else if (event == "down") {
+			keyEvent = InputDispatcher::KeyEvent::DOWN;
+		} else if (event && event != "press") {
+			throw std::runtime_error{"on_key: unknown event " + *event};
+		}
+
+		return m_input.subscribe(key, keyEvent, callback, getSource(callback));
+	});
+
+	y3_table.set_function("off_key", [this](InputDispatcher::Id id) {
+		m_input.unsubscribe(id);
+	});
+
+	y3_table.set_function("input", [this]() { return getInputTable(); });
+
+	// input and dt of every frame, the app exits at the end of a replay
+	y3_table.set_function("record_input", [this](const std::string& path) {
+		recordInput(path);
 	});
 
-	y3_table.set_function("key_clicked", [](int key) {
-		return g_window->isKeyClicked(static_cast<Key>(key));
+	y3_table.set_function("replay_input", [this](const std::string& path) {
+		replayInput(path);
 	});
 
-	y3_table.set_function("mouse_x", []() { return g_window->getMouseX(); });
-	y3_table.set_function("mouse_y", []() { return g_window->getMouseY(); });
-	y3_table.set_function("mouse_dx", []() { return g_window->mouseDeltaX(); });
-	y3_table.set_function("mouse_dy", []() { return g_window->mouseDeltaY(); });
+	y3_table.set_function("stop_input_recording",
+						  [this]() { stopInputRecording(); });
 }
@@ -0,0 +1,93 @@
+#include <algorithm>
+#include "y3.hpp"
+
+using namespace etna;
+
+static float secondsSince(y3::Clock::time_point start) {
+	return std::chrono::duration<float>(y3::Clock::now() - start).count();
+}
+
+void y3::setGcSettings(const GcSettings& settings) {
+	lua_State* L = m_lua.lua_state();
+
+	// Note: also false for NaN, the bounds end up in std::clamp
+	if (!(settings.minStepTime >= 0 &&
+		  settings.minStepTime <= settings.maxStepTime)) {
+		throw std::runtime_error{"GC step times must be 0 <= min <= max"};
+	}
+
+	m_gcSettings = settings;
+	m_gcCycleActive = false;
+	m_gcThreshold = m_lua.memory_used();
+
+	switch (settings.mode) {
+		case GcSettings::Mode::AUTO:
+			lua_gc(L, LUA_GCINC, settings.pause, 0, 0);
+			lua_gc(L, LUA_GCRESTART);
+			break;
+
+		case GcSettings::Mode::INCREMENTAL:
+			lua_gc(L, LUA_GCINC, settings.pause, 0, 0);
+			lua_gc(L, LUA_GCSTOP);
+			break;
+
+		case GcSettings::Mode::GENERATIONAL:
+			lua_gc(L, LUA_GCGEN, settings.minorMultiplier, 0);
+			lua_gc(L, LUA_GCSTOP);
+			break;
+	}
+}
+
+// The automatic collector is stopped outside of AUTO mode: garbage is collected
+// only here, in steps that fit in what is left of the frame budget
+void y3::stepGarbageCollector(Clock::time_point frameStart) {
+	lua_State* L = m_lua.lua_state();
+
+	m_gcStats.steps = 0;
+	m_gcStats.stepTime = 0;
+	m_gcStats.heapSize = m_lua.memory_used();
+
+	if (m_gcSettings.mode == GcSettings::Mode::AUTO) {
+		return;
+	}
+
+	if (!m_gcCycleActive && m_gcStats.heapSize < m_gcThreshold) {
+		return;
+	}
+
+	const auto start = Clock::now();
+
+	const float frameLeft = m_gcSettings.targetFrameTime - secondsSince(frameStart);
+
+	float budget = std::clamp(frameLeft, m_gcSettings.minStepTime,
+							  m_gcSettings.maxStepTime);
+
+	// falling behind the allocation rate, don't let the heap run away
+	if (m_gcStats.heapSize > 2 * m_gcThreshold) {
+		budget = m_gcSettings.maxStepTime;
+	}
+
+	const bool generational =
+		m_gcSettings.mode == GcSettings::Mode::GENERATIONAL;
+
+	m_gcCycleActive = true;
+
+	do {
+		m_gcStats.steps++;
+
+		// in generational mode every step is a whole (minor) collection
+		if (lua_gc(L, LUA_GCSTEP, m_gcSettings.stepSize) || generational) {
+			const int growth = generational ? m_gcSettings.minorMultiplier
+											: m_gcSettings.pause - 100;
+
+			m_gcCycleActive = false;
+			m_gcStats.cycles++;
+			m_gcThreshold =
+				m_lua.memory_used() * (100 + std::max(growth, 0)) / 100;
+			break;
+		}
+	} while (secondsSince(start) < budget);
+
+	m_gcStats.stepTime = secondsSince(start);
+	m_gcStats.heapSize = m_lua.memory_used();
+}
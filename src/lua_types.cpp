@@ -2,8 +2,8 @@
 
 using namespace etna;
 
-void y3::initLuaTypes() {
-	m_lua.new_usertype<Vec3>(
+void y3::initLuaTypes(sol::state_view lua) {
+	lua.new_usertype<Vec3>(
 		"Vec3", sol::constructors<Vec3(float, float, float), Vec3(float)>(),  //
 		"x", sol::property([](const Vec3& v) -> float { return v[0]; }),	  //
 		"y", sol::property([](const Vec3& v) -> float { return v[1]; }),	  //
@@ -21,7 +21,7 @@ void y3::initLuaTypes() {
 						  return Vec3(a[0] * scalar, a[1] * scalar, a[2] * scalar);
 					  }));
 
-	m_lua.new_usertype<Transform>(
+	lua.new_usertype<Transform>(
 		"Transform",  //
 		sol::no_constructor, "new", sol::factories([](sol::table t) {
 			Transform tr;
@@ -48,13 +48,16 @@ void y3::initLuaTypes() {
 		"right", &Transform::right,		   //
 		"up", &Transform::up);
 
-	m_lua.new_usertype<_CameraNode>("CameraNode", sol::base_classes,
-									sol::bases<_SceneNode>());
-
-	m_lua.new_usertype<_MeshNode>("MeshNode", sol::base_classes,
+	lua.new_usertype<_CameraNode>("CameraNode", sol::base_classes,
 								  sol::bases<_SceneNode>());
 
-	m_lua.new_usertype<_SceneNode>(
+	lua.new_usertype<_MeshNode>("MeshNode", sol::base_classes,
+								sol::bases<_SceneNode>());
+
+	lua.new_usertype<_LightNode>("LightNode", sol::base_classes,
+								 sol::bases<_SceneNode>());
+
+	lua.new_usertype<_SceneNode>(
 		"SceneNode",									   //
 		"get_name", &_SceneNode::getName,				   //
 		"translate", &_SceneNode::translate,			   //
@@ -66,7 +69,7 @@ void y3::initLuaTypes() {
 		"add_script", &_SceneNode::addScript,			   //
 		"add", &_SceneNode::add);
 
-	m_lua.new_usertype<etna::Color>(
+	lua.new_usertype<etna::Color>(
 		"Color", sol::constructors<>(),		//
 		"r", &etna::Color::r,				//
 		"g", &etna::Color::g,				//
@@ -75,71 +78,71 @@ void y3::initLuaTypes() {
 		&etna::Color::setAlpha, sol::meta_function::multiplication,
 		[](const etna::Color& c, float f) { return c * f; });
 
-	m_lua["WHITE"] = etna::WHITE;
-	m_lua["BLACK"] = etna::BLACK;
-	m_lua["RED"] = etna::RED;
-	m_lua["GREEN"] = etna::GREEN;
-	m_lua["BLUE"] = etna::BLUE;
-	m_lua["PURPLE"] = etna::PURPLE;
-	m_lua["CELESTE"] = etna::CELESTE;
-	m_lua["YELLOW"] = etna::YELLOW;
-	m_lua["INVISIBLE"] = etna::INVISIBLE;
+	lua["WHITE"] = etna::WHITE;
+	lua["BLACK"] = etna::BLACK;
+	lua["RED"] = etna::RED;
+	lua["GREEN"] = etna::GREEN;
+	lua["BLUE"] = etna::BLUE;
+	lua["PURPLE"] = etna::PURPLE;
+	lua["CELESTE"] = etna::CELESTE;
+	lua["YELLOW"] = etna::YELLOW;
+	lua["INVISIBLE"] = etna::INVISIBLE;
 
-	m_lua["KEY_A"] = etna::KEY_A;
-	m_lua["KEY_B"] = etna::KEY_B;
-	m_lua["KEY_C"] = etna::KEY_C;
-	m_lua["KEY_D"] = etna::KEY_D;
-	m_lua["KEY_E"] = etna::KEY_E;
-	m_lua["KEY_F"] = etna::KEY_F;
-	m_lua["KEY_G"] = etna::KEY_G;
-	m_lua["KEY_H"] = etna::KEY_H;
-	m_lua["KEY_I"] = etna::KEY_I;
-	m_lua["KEY_J"] = etna::KEY_J;
-	m_lua["KEY_K"] = etna::KEY_K;
-	m_lua["KEY_L"] = etna::KEY_L;
-	m_lua["KEY_M"] = etna::KEY_M;
-	m_lua["KEY_N"] = etna::KEY_N;
-	m_lua["KEY_O"] = etna::KEY_O;
-	m_lua["KEY_P"] = etna::KEY_P;
-	m_lua["KEY_Q"] = etna::KEY_Q;
-	m_lua["KEY_R"] = etna::KEY_R;
-	m_lua["KEY_S"] = etna::KEY_S;
-	m_lua["KEY_T"] = etna::KEY_T;
-	m_lua["KEY_U"] = etna::KEY_U;
-	m_lua["KEY_V"] = etna::KEY_V;
-	m_lua["KEY_W"] = etna::KEY_W;
-	m_lua["KEY_X"] = etna::KEY_X;
-	m_lua["KEY_Y"] = etna::KEY_Y;
-	m_lua["KEY_Z"] = etna::KEY_Z;
-	m_lua["KEY_0"] = etna::KEY_0;
-	m_lua["KEY_1"] = etna::KEY_1;
-	m_lua["KEY_2"] = etna::KEY_2;
-	m_lua["KEY_3"] = etna::KEY_2;
-	m_lua["KEY_4"] = etna::KEY_4;
-	m_lua["KEY_5"] = etna::KEY_5;
-	m_lua["KEY_6"] = etna::KEY_6;
-	m_lua["KEY_7"] = etna::KEY_7;
-	m_lua["KEY_8"] = etna::KEY_8;
-	m_lua["KEY_9"] = etna::KEY_9;
-	m_lua["KEY_F1"] = etna::KEY_F1;
-	m_lua["KEY_F2"] = etna::KEY_F2;
-	m_lua["KEY_F3"] = etna::KEY_F3;
-	m_lua["KEY_F4"] = etna::KEY_F4;
-	m_lua["KEY_F5"] = etna::KEY_F5;
-	m_lua["KEY_F6"] = etna::KEY_F6;
-	m_lua["KEY_F7"] = etna::KEY_F7;
-	m_lua["KEY_F8"] = etna::KEY_F8;
-	m_lua["KEY_F9"] = etna::KEY_F9;
-	m_lua["KEY_F10"] = etna::KEY_F10;
-	m_lua["KEY_F11"] = etna::KEY_F11;
-	m_lua["KEY_F12"] = etna::KEY_F12;
-	m_lua["KEY_LEFT"] = etna::KEY_LEFT;
-	m_lua["KEY_SPACE"] = etna::KEY_SPACE;
-	m_lua["KEY_LSHIFT"] = etna::KEY_LEFT_SHIFT;
-	m_lua["KEY_RIGHT"] = etna::KEY_RIGHT;
-	m_lua["KEY_UP"] = etna::KEY_UP;
-	m_lua["KEY_DOWN"] = etna::KEY_DOWN;
-	m_lua["KEY_ENTER"] = etna::KEY_ENTER;
-	m_lua["KEY_BACKSPACE"] = etna::KEY_BACKSPACE;
-	m_lua["KEY_TAB"] = etna::KEY_TAB;
+	lua["KEY_A"] = etna::KEY_A;
+	lua["KEY_B"] = etna::KEY_B;
+	lua["KEY_C"] = etna::KEY_C;
+	lua["KEY_D"] = etna::KEY_D;
+	lua["KEY_E"] = etna::KEY_E;
+	lua["KEY_F"] = etna::KEY_F;
+	lua["KEY_G"] = etna::KEY_G;
+	lua["KEY_H"] = etna::KEY_H;
+	lua["KEY_I"] = etna::KEY_I;
+	lua["KEY_J"] = etna::KEY_J;
+	lua["KEY_K"] = etna::KEY_K;
+	lua["KEY_L"] = etna::KEY_L;
+	lua["KEY_M"] = etna::KEY_M;
+	lua["KEY_N"] = etna::KEY_N;
+	lua["KEY_O"] = etna::KEY_O;
+	lua["KEY_P"] = etna::KEY_P;
+	lua["KEY_Q"] = etna::KEY_Q;
+	lua["KEY_R"] = etna::KEY_R;
+	lua["KEY_S"] = etna::KEY_S;
+	lua["KEY_T"] = etna::KEY_T;
+	lua["KEY_U"] = etna::KEY_U;
+	lua["KEY_V"] = etna::KEY_V;
+	lua["KEY_W"] = etna::KEY_W;
+	lua["KEY_X"] = etna::KEY_X;
+	lua["KEY_Y"] = etna::KEY_Y;
+	lua["KEY_Z"] = etna::KEY_Z;
+	lua["KEY_0"] = etna::KEY_0;
+	lua["KEY_1"] = etna::KEY_1;
+	lua["KEY_2"] = etna::KEY_2;
+	lua["KEY_3"] = etna::KEY_2;
+	lua["KEY_4"] = etna::KEY_4;
+	lua["KEY_5"] = etna::KEY_5;
+	lua["KEY_6"] = etna::KEY_6;
+	lua["KEY_7"] = etna::KEY_7;
+	lua["KEY_8"] = etna::KEY_8;
+	lua["KEY_9"] = etna::KEY_9;
+	lua["KEY_F1"] = etna::KEY_F1;
+	lua["KEY_F2"] = etna::KEY_F2;
+	lua["KEY_F3"] = etna::KEY_F3;
+	lua["KEY_F4"] = etna::KEY_F4;
+	lua["KEY_F5"] = etna::KEY_F5;
+	lua["KEY_F6"] = etna::KEY_F6;
+	lua["KEY_F7"] = etna::KEY_F7;
+	lua["KEY_F8"] = etna::KEY_F8;
+	lua["KEY_F9"] = etna::KEY_F9;
+	lua["KEY_F10"] = etna::KEY_F10;
+	lua["KEY_F11"] = etna::KEY_F11;
+	lua["KEY_F12"] = etna::KEY_F12;
+	lua["KEY_LEFT"] = etna::KEY_LEFT;
+	lua["KEY_SPACE"] = etna::KEY_SPACE;
+	lua["KEY_LSHIFT"] = etna::KEY_LEFT_SHIFT;
+	lua["KEY_RIGHT"] = etna::KEY_RIGHT;
+	lua["KEY_UP"] = etna::KEY_UP;
+	lua["KEY_DOWN"] = etna::KEY_DOWN;
+	lua["KEY_ENTER"] = etna::KEY_ENTER;
+	lua["KEY_BACKSPACE"] = etna::KEY_BACKSPACE;
+	lua["KEY_TAB"] = etna::KEY_TAB;
 }
@@ -1,4 +1,5 @@
 #include "etna/etna_core.hpp"
+#include "trace.hpp"
 #include "y3.hpp"
 
 constexpr uint32_t WINDOW_WIDTH{800};
@@ -6,20 +7,122 @@ constexpr uint32_t WINDOW_HEIGHT{600};
 
 using namespace etna;
 
+static void printStartupStats(const y3::StartupStats& stats, float sceneTime) {
+	const auto ms = [](float seconds) { return seconds * 1000; };
+
+	std::cout << "Startup (ms):\n"
+			  << "  device        " << ms(stats.engineTime) << '\n'
+			  << "  window        " << ms(stats.windowTime) << '\n'
+			  << "  renderer      " << ms(stats.rendererTime) << '\n'
+			  << "  lua setup     " << ms(stats.luaTime) << " (overlapped)\n"
+			  << "  scene read    " << ms(stats.sceneReadTime) << " (overlapped)\n"
+			  << "  lua wait      " << ms(stats.waitTime) << '\n'
+			  << "  constructor   " << ms(stats.totalTime) << '\n'
+			  << "  first scene   " << ms(sceneTime) << '\n'
+			  << "  total         " << ms(stats.totalTime + sceneTime) << std::endl;
+}
+
 int main(int argc, char** argv) {
 	uint32_t width = WINDOW_WIDTH;
 	uint32_t height = WINDOW_HEIGHT;
 
-	if (argc == 3) {
-		width = std::stoi(argv[1]);
-		height = std::stoi(argv[2]);
+	std::string bakedScene;
+	bool startupStats = false;
+	std::string tracePath;
+	float statsInterval = 0;
+	std::string watchDir;
+	bool headless = false;
+	y3::LoopSettings loopSettings;
+	std::string recordPath;
+	std::string replayPath;
+	std::string replayTimesPath;
+	std::vector<std::string> args;
+
+	for (int i = 1; i < argc; i++) {
+		const std::string arg = argv[i];
+
+		if (arg == "--bake" && i + 1 < argc) {
+			bakedScene = argv[++i];
+		} else if (arg == "--trace" && i + 1 < argc) {
+			tracePath = argv[++i];
+		} else if (arg == "--startup-stats") {
+			startupStats = true;
+			y3::g_pipelineStats = true;
+		} else if (arg == "--pipeline-stats") {
+			y3::g_pipelineStats = true;
+		} else if (arg == "--record" && i + 1 < argc) {
+			recordPath = argv[++i];
+		} else if (arg == "--replay" && i + 1 < argc) {
+			replayPath = argv[++i];
+		} else if (arg == "--replay-times" && i + 1 < argc) {
+			replayTimesPath = argv[++i];
+		} else if (arg == "--stats-log" && i + 1 < argc) {
+			statsInterval = std::stof(argv[++i]);
+		} else if (arg == "--watch" && i + 1 < argc) {
+			watchDir = argv[++i];
+		} else if (arg == "--headless") {
+			headless = true;
+		} else if (arg == "--fixed-loop") {
+			loopSettings.mode = y3::LoopSettings::Mode::FIXED;
+		} else if (arg == "--max-fps" && i + 1 < argc) {
+			loopSettings.maxFps = std::stof(argv[++i]);
+		} else if (arg == "--lua-pool") {
+			LuaAllocator::g_pooling = true;
+		} else if (arg == "--profile-scripts") {
+			Script::g_profiling = true;
+		} else {
+			args.push_back(arg);
+		}
+	}
+
+	if (args.size() == 2) {
+		width = std::stoi(args[0]);
+		height = std::stoi(args[1]);
+	}
+
+	// from the start, so that the startup is in the trace
+	if (!tracePath.empty()) {
+		trace::start();
 	}
 
 	y3 app(width, height);
+	app.setStatsLog(statsInterval);
+	app.setLoopSettings(loopSettings);
+	app.setHeadless(headless);
+
+	if (!watchDir.empty()) {
+		app.watch(watchDir);
+	}
 
 	try {
+		if (!bakedScene.empty()) {
+			app.bakeScene(bakedScene);
+			return 0;
+		}
+
+		// before the first scene, so that its start scripts are replayed too
+		if (!replayPath.empty()) {
+			app.replayInput(replayPath, replayTimesPath);
+		} else if (!recordPath.empty()) {
+			app.recordInput(recordPath);
+		}
+
+		const auto sceneStart = y3::Clock::now();
+
 		app.switchScene("main");
+
+		if (startupStats) {
+			const std::chrono::duration<float> sceneTime =
+				y3::Clock::now() - sceneStart;
+
+			printStartupStats(app.getStartupStats(), sceneTime.count());
+		}
+
 		app.run();
+
+		if (!tracePath.empty()) {
+			trace::stop(tracePath);
+		}
 	} catch (const std::exception& e) {
 		std::cerr << "Error loading scene: " << e.what() << std::endl;
 		return -1;
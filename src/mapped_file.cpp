@@ -0,0 +1,43 @@
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <filesystem>
+#include "mapped_file.hpp"
+
+using namespace etna;
+
+MappedFile::MappedFile(const std::string& path) {
+	const int fd = open(path.c_str(), O_RDONLY);
+
+	if (fd < 0) {
+		return;
+	}
+
+	struct stat info;
+
+	// empty files can't be mapped
+	if (fstat(fd, &info) == 0 && info.st_size > 0) {
+		void* data = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+		if (data != MAP_FAILED) {
+			m_data = static_cast<const char*>(data);
+			m_size = info.st_size;
+		}
+	}
+
+	close(fd);
+}
+
+MappedFile::~MappedFile() {
+	if (m_data != nullptr) {
+		munmap(const_cast<char*>(m_data), m_size);
+	}
+}
+
+int64_t etna::getFileTime(const std::string& path) {
+	std::error_code error;
+	const auto time = std::filesystem::last_write_time(path, error);
+
+	return error ? -1 : time.time_since_epoch().count();
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+namespace etna {
+
+// read only mapping of a whole file, invalid if the file can't be opened
+class MappedFile {
+public:
+	explicit MappedFile(const std::string& path);
+
+	~MappedFile();
+
+	bool isValid() const { return m_data != nullptr; }
+
+	const char* getData() const { return m_data; }
+
+	size_t getSize() const { return m_size; }
+
+private:
+	const char* m_data{nullptr};
+	size_t m_size{0};
+
+public:
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+	MappedFile(MappedFile&&) = delete;
+	MappedFile& operator=(MappedFile&&) = delete;
+};
+
+// modification time, -1 if the file doesn't exist
+int64_t getFileTime(const std::string& path);
+
+}  // namespace etna
@@ -0,0 +1,803 @@
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <optional>
+#include <thread>
+#include "mapped_file.hpp"
+#include "mesh_loader.hpp"
+
+using namespace etna;
+
+// below these, starting another thread costs more than it saves
+static constexpr size_t MIN_OBJ_BYTES_PER_THREAD = 1 << 20;
+static constexpr size_t MIN_ITEMS_PER_THREAD = 1 << 14;
+
+static constexpr size_t MAX_JSON_DEPTH = 64;
+
+// runs fn(begin, end) on slices of [0, count), rethrows the first exception
+template <typename F>
+static void parallelFor(size_t count, size_t minPerThread, F&& fn) {
+	const size_t maxThreads = std::max(std::thread::hardware_concurrency(), 1u);
+	const size_t threads = std::clamp<size_t>(count / minPerThread, 1, maxThreads);
+
+	if (threads == 1) {
+		fn(size_t{0}, count);
+		return;
+	}
+
+	std::vector<std::thread> workers;
+	std::vector<std::exception_ptr> errors(threads);
+
+	for (size_t i = 0; i < threads; i++) {
+		workers.emplace_back([&, i] {
+			try {
+				fn(count * i / threads, count * (i + 1) / threads);
+			} catch (...) {
+				errors[i] = std::current_exception();
+			}
+		});
+	}
+
+	for (std::thread& worker : workers) {
+		worker.join();
+	}
+
+	for (const std::exception_ptr& error : errors) {
+		if (error) {
+			std::rethrow_exception(error);
+		}
+	}
+}
+
+static Vec3 getFaceNormal(const Vec3& a, const Vec3& b, const Vec3& c) {
+	Vec3 normal = Vec3(b - a).cross(c - a);
+	return normal.normalize();
+}
+
+// OBJ
+
+struct ObjCounts {
+	size_t positions{0};
+	size_t normals{0};
+	size_t uvs{0};
+	size_t triangles{0};
+};
+
+// whole lines, with where their elements go in the shared arrays
+struct ObjChunk {
+	const char* begin;
+	const char* end;
+	ObjCounts counts;
+	ObjCounts offsets;
+};
+
+// 0 based, -1 if missing
+struct ObjCorner {
+	int32_t position{-1};
+	int32_t uv{-1};
+	int32_t normal{-1};
+};
+
+static bool isSpace(char c) {
+	return c == ' ' || c == '\t' || c == '\r';
+}
+
+static const char* skipSpaces(const char* p, const char* end) {
+	while (p < end && isSpace(*p)) {
+		p++;
+	}
+
+	return p;
+}
+
+static const char* getLineEnd(const char* p, const char* end) {
+	const void* newline = std::memchr(p, '\n', end - p);
+	return newline ? static_cast<const char*>(newline) : end;
+}
+
+static bool isElement(const char* p, const char* end, std::string_view name) {
+	return end > p && static_cast<size_t>(end - p) > name.size() &&
+		   std::equal(name.begin(), name.end(), p) && isSpace(p[name.size()]);
+}
+
+static const char* parseFloat(const char* p, const char* end, float& value) {
+	p = skipSpaces(p, end);
+
+	auto [next, error] = std::from_chars(p, end, value);
+
+	if (error != std::errc{}) {
+		throw std::runtime_error{"expected a number"};
+	}
+
+	return next;
+}
+
+// 1 based, negative indices are relative to the elements read so far
+static const char* parseIndex(const char* p,
+							  const char* end,
+							  size_t count,
+							  int32_t& index) {
+	int32_t value = 0;
+
+	auto [next, error] = std::from_chars(p, end, value);
+
+	if (error != std::errc{} || value == 0) {
+		throw std::runtime_error{"invalid index"};
+	}
+
+	index = value > 0 ? value - 1 : static_cast<int32_t>(count) + value;
+
+	return next;
+}
+
+static size_t countCorners(const char* p, const char* end) {
+	size_t corners = 0;
+
+	while (true) {
+		p = skipSpaces(p, end);
+
+		if (p == end || *p == '#') {
+			return corners;
+		}
+
+		corners++;
+
+		while (p < end && !isSpace(*p)) {
+			p++;
+		}
+	}
+}
+
+static void countObj(ObjChunk& chunk) {
+	for (const char* p = chunk.begin; p < chunk.end;) {
+		const char* end = getLineEnd(p, chunk.end);
+		p = skipSpaces(p, end);
+
+		if (isElement(p, end, "v")) {
+			chunk.counts.positions++;
+		} else if (isElement(p, end, "vn")) {
+			chunk.counts.normals++;
+		} else if (isElement(p, end, "vt")) {
+			chunk.counts.uvs++;
+		} else if (isElement(p, end, "f")) {
+			const size_t corners = countCorners(p + 1, end);
+			chunk.counts.triangles += corners >= 3 ? corners - 2 : 0;
+		}
+
+		p = end + 1;
+	}
+}
+
+static void parseObj(const ObjChunk& chunk,
+					 std::vector<Vec3>& positions,
+					 std::vector<Vec3>& normals,
+					 std::vector<Vec2>& uvs,
+					 std::vector<ObjCorner>& corners) {
+	ObjCounts at = chunk.offsets;
+
+	for (const char* p = chunk.begin; p < chunk.end;) {
+		const char* end = getLineEnd(p, chunk.end);
+		p = skipSpaces(p, end);
+
+		if (isElement(p, end, "v")) {
+			Vec3& position = positions[at.positions++];
+			p = parseFloat(p + 1, end, position[0]);
+			p = parseFloat(p, end, position[1]);
+			parseFloat(p, end, position[2]);
+		} else if (isElement(p, end, "vn")) {
+			Vec3& normal = normals[at.normals++];
+			p = parseFloat(p + 2, end, normal[0]);
+			p = parseFloat(p, end, normal[1]);
+			parseFloat(p, end, normal[2]);
+		} else if (isElement(p, end, "vt")) {
+			Vec2& uv = uvs[at.uvs++];
+			p = parseFloat(p + 2, end, uv[0]);
+			parseFloat(p, end, uv[1]);
+
+			// OBJ puts the origin at the bottom
+			uv[1] = 1 - uv[1];
+		} else if (isElement(p, end, "f")) {
+			ObjCorner first;
+			ObjCorner previous;
+			size_t count = 0;
+
+			for (p = skipSpaces(p + 1, end); p < end && *p != '#';
+				 p = skipSpaces(p, end)) {
+				ObjCorner corner;
+
+				p = parseIndex(p, end, at.positions, corner.position);
+
+				if (p < end && *p == '/') {
+					if (++p < end && *p != '/') {
+						p = parseIndex(p, end, at.uvs, corner.uv);
+					}
+
+					if (p < end && *p == '/') {
+						p = parseIndex(p + 1, end, at.normals, corner.normal);
+					}
+				}
+
+				// fan triangulation, faces are expected to be convex
+				if (count == 0) {
+					first = corner;
+				} else if (count >= 2) {
+					ObjCorner* triangle = &corners[3 * at.triangles++];
+					triangle[0] = first;
+					triangle[1] = previous;
+					triangle[2] = corner;
+				}
+
+				previous = corner;
+				count++;
+			}
+		}
+
+		p = end + 1;
+	}
+}
+
+template <typename T>
+static const T& getObjElement(const std::vector<T>& elements, int32_t index) {
+	if (index < 0 || static_cast<size_t>(index) >= elements.size()) {
+		throw std::runtime_error{"index out of range"};
+	}
+
+	return elements[index];
+}
+
+// Note: corners are not deduplicated, every triangle gets its own vertices, which
+// keeps this last pass parallel
+Mesh::CreateInfo etna::loadObj(const char* data, size_t size) {
+	const char* end = data + size;
+
+	const size_t maxThreads = std::max(std::thread::hardware_concurrency(), 1u);
+	const size_t chunkCount =
+		std::clamp<size_t>(size / MIN_OBJ_BYTES_PER_THREAD, 1, maxThreads);
+
+	std::vector<ObjChunk> chunks;
+
+	for (size_t i = 0; i < chunkCount; i++) {
+		const char* begin = i == 0 ? data : chunks.back().end;
+		const char* split = data + size * (i + 1) / chunkCount;
+		const char* chunkEnd =
+			i + 1 == chunkCount ? end : getLineEnd(std::max(split, begin), end);
+
+		chunks.push_back({.begin = begin, .end = std::min(chunkEnd + 1, end)});
+	}
+
+	parallelFor(chunks.size(), 1, [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; i++) {
+			countObj(chunks[i]);
+		}
+	});
+
+	ObjCounts total;
+
+	for (ObjChunk& chunk : chunks) {
+		chunk.offsets = total;
+		total.positions += chunk.counts.positions;
+		total.normals += chunk.counts.normals;
+		total.uvs += chunk.counts.uvs;
+		total.triangles += chunk.counts.triangles;
+	}
+
+	std::vector<Vec3> positions(total.positions);
+	std::vector<Vec3> normals(total.normals);
+	std::vector<Vec2> uvs(total.uvs);
+	std::vector<ObjCorner> corners(3 * total.triangles);
+
+	parallelFor(chunks.size(), 1, [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; i++) {
+			parseObj(chunks[i], positions, normals, uvs, corners);
+		}
+	});
+
+	Mesh::CreateInfo info;
+	info.vertices.resize(corners.size());
+	info.indices.resize(corners.size());
+
+	auto expand = [&](size_t begin, size_t end) {
+		for (size_t t = begin; t < end; t++) {
+			const ObjCorner* triangle = &corners[3 * t];
+
+			const Vec3 triangleNormal =
+				getFaceNormal(getObjElement(positions, triangle[0].position),
+							  getObjElement(positions, triangle[1].position),
+							  getObjElement(positions, triangle[2].position));
+
+			for (size_t k = 0; k < 3; k++) {
+				const ObjCorner& corner = triangle[k];
+
+				info.vertices[3 * t + k] = {
+					.position = positions[corner.position],
+					.normal = corner.normal < 0
+								  ? triangleNormal
+								  : getObjElement(normals, corner.normal),
+					.uv = corner.uv < 0 ? Vec2{0, 0} : getObjElement(uvs, corner.uv),
+				};
+
+				info.indices[3 * t + k] = 3 * t + k;
+			}
+		}
+	};
+
+	parallelFor(total.triangles, MIN_ITEMS_PER_THREAD, expand);
+
+	return info;
+}
+
+// glTF
+
+// just enough JSON for the glTF header, strings are not unescaped
+struct Json {
+	enum class Type {
+		NUL,
+		BOOL,
+		NUMBER,
+		STRING,
+		ARRAY,
+		OBJECT,
+	};
+
+	Type type{Type::NUL};
+	double number{0};
+	std::string_view string;
+	std::vector<Json> items;
+	std::vector<std::string_view> keys;
+
+	const Json* find(std::string_view key) const {
+		auto it = std::find(keys.begin(), keys.end(), key);
+		return it == keys.end() ? nullptr : &items[it - keys.begin()];
+	}
+
+	const Json& at(std::string_view key) const {
+		const Json* value = find(key);
+
+		if (value == nullptr) {
+			throw std::runtime_error{"missing " + std::string{key}};
+		}
+
+		return *value;
+	}
+
+	const Json& at(size_t index) const {
+		if (type != Type::ARRAY || index >= items.size()) {
+			throw std::runtime_error{"invalid index"};
+		}
+
+		return items[index];
+	}
+
+	size_t getSize(std::string_view key) const {
+		return at(key).toSize(key);
+	}
+
+	size_t getSize(std::string_view key, size_t fallback) const {
+		const Json* value = find(key);
+		return value ? value->toSize(key) : fallback;
+	}
+
+private:
+	// Note: SIZE_MAX rounds up to 2^64 as a double, so the bound is exclusive
+	size_t toSize(std::string_view key) const {
+		if (type != Type::NUMBER || !std::isfinite(number) || number < 0 ||
+			number != std::floor(number) ||
+			number >= static_cast<double>(SIZE_MAX)) {
+			throw std::runtime_error{"invalid " + std::string{key}};
+		}
+
+		return static_cast<size_t>(number);
+	}
+};
+
+class JsonParser {
+public:
+	explicit JsonParser(std::string_view text)
+		: m_p{text.data()}, m_end{text.data() + text.size()} {}
+
+	Json parse(size_t depth = 0) {
+		if (depth > MAX_JSON_DEPTH) {
+			throw std::runtime_error{"JSON too deep"};
+		}
+
+		Json value;
+
+		switch (peek()) {
+			case '{':
+				value.type = Json::Type::OBJECT;
+				m_p++;
+
+				while (peek() != '}') {
+					value.keys.push_back(parseString());
+					expect(':');
+					value.items.push_back(parse(depth + 1));
+
+					if (peek() != ',') {
+						break;
+					}
+
+					m_p++;
+				}
+
+				expect('}');
+				break;
+
+			case '[':
+				value.type = Json::Type::ARRAY;
+				m_p++;
+
+				while (peek() != ']') {
+					value.items.push_back(parse(depth + 1));
+
+					if (peek() != ',') {
+						break;
+					}
+
+					m_p++;
+				}
+
+				expect(']');
+				break;
+
+			case '"':
+				value.type = Json::Type::STRING;
+				value.string = parseString();
+				break;
+
+			case 't':
+			case 'f':
+			case 'n':
+				value.type = *m_p == 'n' ? Json::Type::NUL : Json::Type::BOOL;
+				value.number = *m_p == 't';
+
+				while (m_p < m_end && std::isalpha(*m_p)) {
+					m_p++;
+				}
+				break;
+
+			default: {
+				value.type = Json::Type::NUMBER;
+
+				auto [next, error] = std::from_chars(m_p, m_end, value.number);
+
+				if (error != std::errc{}) {
+					throw std::runtime_error{"invalid JSON"};
+				}
+
+				m_p = next;
+			}
+		}
+
+		return value;
+	}
+
+private:
+	const char* m_p;
+	const char* m_end;
+
+	char peek() {
+		while (m_p < m_end && std::isspace(*m_p)) {
+			m_p++;
+		}
+
+		if (m_p == m_end) {
+			throw std::runtime_error{"truncated JSON"};
+		}
+
+		return *m_p;
+	}
+
+	void expect(char c) {
+		if (peek() != c) {
+			throw std::runtime_error{"invalid JSON"};
+		}
+
+		m_p++;
+	}
+
+	std::string_view parseString() {
+		expect('"');
+
+		const char* begin = m_p;
+
+		while (m_p < m_end && *m_p != '"') {
+			m_p += *m_p == '\\' ? 2 : 1;
+		}
+
+		if (m_p >= m_end) {
+			throw std::runtime_error{"truncated JSON"};
+		}
+
+		return {begin, static_cast<size_t>(m_p++ - begin)};
+	}
+};
+
+static constexpr uint32_t GLB_MAGIC = 0x46546C67;	  // "glTF"
+static constexpr uint32_t GLB_CHUNK_JSON = 0x4E4F534A;  // "JSON"
+static constexpr uint32_t GLB_CHUNK_BIN = 0x004E4942;	  // "BIN"
+
+static constexpr uint32_t GLTF_TRIANGLES = 4;
+
+enum GltfComponent : uint32_t {
+	UNSIGNED_BYTE = 5121,
+	UNSIGNED_SHORT = 5123,
+	UNSIGNED_INT = 5125,
+	FLOAT = 5126,
+};
+
+// elements of an accessor, checked against the binary chunk
+struct GltfAccessor {
+	const char* data{nullptr};
+	size_t count{0};
+	size_t stride{0};
+	uint32_t component{0};
+
+	template <typename T>
+	T read(size_t element, size_t index = 0) const {
+		T value;
+		std::memcpy(&value, data + element * stride + index * sizeof(T), sizeof(T));
+		return value;
+	}
+
+	uint32_t readIndex(size_t element) const {
+		switch (component) {
+			case UNSIGNED_BYTE:
+				return read<uint8_t>(element);
+			case UNSIGNED_SHORT:
+				return read<uint16_t>(element);
+			default:
+				return read<uint32_t>(element);
+		}
+	}
+};
+
+static GltfAccessor getAccessor(const Json& gltf,
+								size_t index,
+								std::string_view bin,
+								std::string_view type,
+								std::initializer_list<uint32_t> components) {
+	const Json& accessor = gltf.at("accessors").at(index);
+	const Json& view = gltf.at("bufferViews").at(accessor.getSize("bufferView"));
+
+	if (view.getSize("buffer") != 0) {
+		throw std::runtime_error{"external buffers are not supported"};
+	}
+
+	GltfAccessor result{
+		.count = accessor.getSize("count"),
+		.component = static_cast<uint32_t>(accessor.getSize("componentType")),
+	};
+
+	if (accessor.at("type").string != type ||
+		std::find(components.begin(), components.end(), result.component) ==
+			components.end()) {
+		throw std::runtime_error{"unsupported accessor format"};
+	}
+
+	const size_t componentSize = result.component == UNSIGNED_BYTE	  ? 1
+								 : result.component == UNSIGNED_SHORT ? 2
+																	  : 4;
+	const size_t elementSize =
+		componentSize * (type == "SCALAR" ? 1 : type == "VEC2" ? 2 : 3);
+
+	result.stride = view.getSize("byteStride", elementSize);
+
+	const size_t viewOffset = view.getSize("byteOffset", 0);
+	const size_t viewLength = view.getSize("byteLength");
+	const size_t offset = accessor.getSize("byteOffset", 0);
+
+	// Note: subtractions and divisions only, so that a huge count or stride can't
+	// wrap around and pass
+	if (viewOffset > bin.size() || viewLength > bin.size() - viewOffset ||
+		offset > viewLength || elementSize > viewLength - offset) {
+		throw std::runtime_error{"accessor out of its buffer"};
+	}
+
+	if (result.count > 1) {
+		if (result.stride < elementSize) {
+			throw std::runtime_error{"invalid byteStride"};
+		}
+
+		if (result.count - 1 > (viewLength - offset - elementSize) / result.stride) {
+			throw std::runtime_error{"accessor out of its buffer"};
+		}
+	}
+
+	result.data = bin.data() + viewOffset + offset;
+
+	return result;
+}
+
+struct GltfPrimitive {
+	GltfAccessor positions;
+	std::optional<GltfAccessor> normals;
+	std::optional<GltfAccessor> uvs;
+	std::optional<GltfAccessor> indices;
+	size_t firstVertex{0};
+	size_t firstIndex{0};
+};
+
+static std::string_view getGlbChunk(const char* data,
+									size_t size,
+									size_t& offset,
+									uint32_t type) {
+	uint32_t header[2];
+
+	if (offset + sizeof(header) > size) {
+		throw std::runtime_error{"truncated file"};
+	}
+
+	std::memcpy(header, data + offset, sizeof(header));
+	offset += sizeof(header);
+
+	if (header[1] != type || offset + header[0] > size) {
+		throw std::runtime_error{"invalid chunk"};
+	}
+
+	const std::string_view chunk{data + offset, header[0]};
+	offset += header[0];
+
+	return chunk;
+}
+
+Mesh::CreateInfo etna::loadGlb(const char* data, size_t size) {
+	uint32_t header[3];
+
+	if (size < sizeof(header)) {
+		throw std::runtime_error{"truncated file"};
+	}
+
+	std::memcpy(header, data, sizeof(header));
+
+	if (header[0] != GLB_MAGIC || header[1] != 2) {
+		throw std::runtime_error{"not a glTF 2 binary"};
+	}
+
+	size_t offset = sizeof(header);
+
+	const Json gltf =
+		JsonParser{getGlbChunk(data, size, offset, GLB_CHUNK_JSON)}.parse();
+	const std::string_view bin =
+		offset < size ? getGlbChunk(data, size, offset, GLB_CHUNK_BIN) : "";
+
+	std::vector<GltfPrimitive> primitives;
+	size_t vertexCount = 0;
+	size_t indexCount = 0;
+
+	for (const Json& mesh : gltf.at("meshes").items) {
+		for (const Json& primitive : mesh.at("primitives").items) {
+			if (primitive.getSize("mode", GLTF_TRIANGLES) != GLTF_TRIANGLES) {
+				throw std::runtime_error{"only triangle lists are supported"};
+			}
+
+			const Json& attributes = primitive.at("attributes");
+
+			GltfPrimitive result{
+				.positions = getAccessor(gltf, attributes.getSize("POSITION"),
+										 bin, "VEC3", {FLOAT}),
+				.firstVertex = vertexCount,
+				.firstIndex = indexCount,
+			};
+
+			if (attributes.find("NORMAL")) {
+				result.normals = getAccessor(gltf, attributes.getSize("NORMAL"),
+											 bin, "VEC3", {FLOAT});
+			}
+
+			if (attributes.find("TEXCOORD_0")) {
+				result.uvs = getAccessor(gltf, attributes.getSize("TEXCOORD_0"),
+										 bin, "VEC2", {FLOAT});
+			}
+
+			if (primitive.find("indices")) {
+				result.indices = getAccessor(
+					gltf, primitive.getSize("indices"), bin, "SCALAR",
+					{UNSIGNED_BYTE, UNSIGNED_SHORT, UNSIGNED_INT});
+			}
+
+			vertexCount += result.positions.count;
+			indexCount += result.indices ? result.indices->count
+										 : result.positions.count;
+
+			primitives.push_back(result);
+		}
+	}
+
+	Mesh::CreateInfo info;
+	info.vertices.resize(vertexCount);
+	info.indices.resize(indexCount);
+
+	for (const GltfPrimitive& primitive : primitives) {
+		Vertex* vertices = info.vertices.data() + primitive.firstVertex;
+		Index* indices = info.indices.data() + primitive.firstIndex;
+
+		const size_t count = primitive.positions.count;
+
+		parallelFor(count, MIN_ITEMS_PER_THREAD, [&](size_t begin, size_t end) {
+			for (size_t i = begin; i < end; i++) {
+				Vertex& vertex = vertices[i];
+
+				for (size_t k = 0; k < 3; k++) {
+					vertex.position[k] = primitive.positions.read<float>(i, k);
+					vertex.normal[k] =
+						primitive.normals ? primitive.normals->read<float>(i, k) : 0;
+				}
+
+				vertex.uv = primitive.uvs ? Vec2{primitive.uvs->read<float>(i, 0),
+												 primitive.uvs->read<float>(i, 1)}
+										  : Vec2{0, 0};
+			}
+		});
+
+		const size_t primitiveIndices =
+			primitive.indices ? primitive.indices->count : count;
+
+		auto copyIndices = [&](size_t begin, size_t end) {
+			for (size_t i = begin; i < end; i++) {
+				const uint32_t index = primitive.indices
+										   ? primitive.indices->readIndex(i)
+										   : static_cast<uint32_t>(i);
+
+				if (index >= count) {
+					throw std::runtime_error{"index out of range"};
+				}
+
+				indices[i] = primitive.firstVertex + index;
+			}
+		};
+
+		parallelFor(primitiveIndices, MIN_ITEMS_PER_THREAD, copyIndices);
+
+		if (primitive.normals) {
+			continue;
+		}
+
+		// smooth normals, weighted by the area of the triangles
+		for (size_t i = 0; i + 2 < primitiveIndices; i += 3) {
+			Vertex& a = info.vertices[indices[i]];
+			Vertex& b = info.vertices[indices[i + 1]];
+			Vertex& c = info.vertices[indices[i + 2]];
+
+			const Vec3 edge = b.position - a.position;
+			const Vec3 normal = edge.cross(c.position - a.position);
+
+			a.normal = a.normal + normal;
+			b.normal = b.normal + normal;
+			c.normal = c.normal + normal;
+		}
+
+		for (size_t i = 0; i < count; i++) {
+			vertices[i].normal.normalize();
+		}
+	}
+
+	return info;
+}
+
+Mesh::CreateInfo etna::loadMeshFile(const std::string& path) {
+	const MappedFile file{path};
+
+	if (!file.isValid()) {
+		throw std::runtime_error{"Mesh not found: " + path};
+	}
+
+	std::string extension = std::filesystem::path{path}.extension().string();
+	std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+
+	try {
+		if (extension == ".obj") {
+			return loadObj(file.getData(), file.getSize());
+		}
+
+		if (extension == ".glb") {
+			return loadGlb(file.getData(), file.getSize());
+		}
+	} catch (const std::exception& e) {
+		throw std::runtime_error{"Failed to load mesh " + path + ": " + e.what()};
+	}
+
+	throw std::runtime_error{"Unsupported mesh format: " + path};
+}
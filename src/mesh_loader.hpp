@@ -0,0 +1,19 @@
+#pragma once
+
+#include <string>
+#include "etna/mesh.hpp"
+
+namespace etna {
+
+// Note: files are mapped and parsed by several threads, which write straight into
+// the arrays of the create info
+Mesh::CreateInfo loadObj(const char* data, size_t size);
+
+// Note: every triangle primitive of every mesh is merged, node transforms are
+// ignored and the buffers must be in the binary chunk
+Mesh::CreateInfo loadGlb(const char* data, size_t size);
+
+// picks the loader from the extension
+Mesh::CreateInfo loadMeshFile(const std::string& path);
+
+}  // namespace etna
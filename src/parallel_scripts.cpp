@@ -0,0 +1,312 @@
+#include <iostream>
+#include <string_view>
+#include "parallel_scripts.hpp"
+#include "trace.hpp"
+#include "y3.hpp"
+
+using namespace etna;
+
+// what scripts see as their node in a worker
+struct ParallelScripts::Node {
+	_SceneNode* node;
+	Transform transform;
+	std::vector<TransformCommand>* commands;
+
+	std::string getName() const { return node->getName(); }
+
+	const Transform& getTransform() const { return transform; }
+
+	void updateTransform(const Transform& newTransform) {
+		transform = newTransform;
+		commands->push_back({node, transform});
+	}
+
+	void updatePosition(const Vec3& position) {
+		transform.position = position;
+		updateTransform(transform);
+	}
+
+	void translate(const Vec3& translation) {
+		transform.position += translation;
+		updateTransform(transform);
+	}
+
+	void rotate(float yaw, float pitch, float roll) {
+		transform.yaw += yaw;
+		transform.pitch += pitch;
+		transform.roll += roll;
+		updateTransform(transform);
+	}
+};
+
+static constexpr uint32_t MAX_COPY_DEPTH = 16;
+
+static sol::object copyValue(const sol::object& value,
+							 sol::state_view lua,
+							 uint32_t depth = 0) {
+	switch (value.get_type()) {
+		case sol::type::boolean:
+			return sol::make_object(lua, value.as<bool>());
+
+		case sol::type::number: {
+			lua_State* L = value.lua_state();
+			value.push();
+
+			sol::object copy = lua_isinteger(L, -1)
+								   ? sol::make_object(lua, lua_tointeger(L, -1))
+								   : sol::make_object(lua, lua_tonumber(L, -1));
+
+			lua_pop(L, 1);
+			return copy;
+		}
+
+		case sol::type::string:
+			return sol::make_object(lua, value.as<std::string>());
+
+		case sol::type::table: {
+			if (depth == MAX_COPY_DEPTH) {
+				return sol::lua_nil;
+			}
+
+			sol::table copy = lua.create_table();
+
+			for (const auto& [key, element] : value.as<sol::table>()) {
+				copy.raw_set(copyValue(key, lua, depth + 1),
+							 copyValue(element, lua, depth + 1));
+			}
+
+			return copy;
+		}
+
+		case sol::type::userdata:
+			if (value.is<Vec3>()) {
+				return sol::make_object(lua, value.as<Vec3>());
+			}
+
+			if (value.is<Transform>()) {
+				return sol::make_object(lua, value.as<Transform>());
+			}
+
+			if (value.is<Color>()) {
+				return sol::make_object(lua, value.as<Color>());
+			}
+
+			return sol::lua_nil;
+
+		default:
+			return sol::lua_nil;
+	}
+}
+
+ParallelScripts::~ParallelScripts() {
+	{
+		std::lock_guard lock(m_mutex);
+		m_stop = true;
+	}
+
+	m_start.notify_all();
+
+	for (auto& worker : m_workers) {
+		worker->thread.join();
+	}
+}
+
+// workers only wait between runs, so their states can be used from here
+void ParallelScripts::seed(int64_t seed) {
+	m_seed = seed;
+
+	for (size_t i = 0; i < m_workers.size(); i++) {
+		m_workers[i]->lua["math"]["randomseed"](seed + static_cast<int64_t>(i));
+	}
+}
+
+void ParallelScripts::init() {
+	const uint32_t count = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+
+	for (uint32_t i = 0; i < count; i++) {
+		auto worker = std::make_unique<Worker>();
+
+		worker->lua.open_libraries(sol::lib::base, sol::lib::math,
+								   sol::lib::string, sol::lib::table);
+
+		if (m_seed) {
+			worker->lua["math"]["randomseed"](*m_seed + i);
+		}
+
+		y3::initLuaTypes(worker->lua);
+
+		worker->lua.new_usertype<Node>(
+			"ParallelNode",								 //
+			"get_name", &Node::getName,					 //
+			"get_transform", &Node::getTransform,		 //
+			"update_transform", &Node::updateTransform,	 //
+			"update_position", &Node::updatePosition,	 //
+			"translate", &Node::translate,				 //
+			"rotate", &Node::rotate);
+
+		worker->thread =
+			std::thread(&ParallelScripts::work, this, std::ref(*worker));
+
+		m_workers.push_back(std::move(worker));
+	}
+}
+
+// lua_load gives the globals to the first upvalue, which is only _ENV when the
+// function reads a global before it reads any captured local
+static void bindUpvalues(sol::protected_function& fn) {
+	lua_State* L = fn.lua_state();
+
+	fn.push();
+
+	for (int i = 1; const char* upvalue = lua_getupvalue(L, -1, i); i++) {
+		const bool env = std::string_view{upvalue} == "_ENV";
+
+		lua_pop(L, 1);
+
+		if (env) {
+			lua_pushglobaltable(L);
+		} else {
+			lua_pushnil(L);
+		}
+
+		lua_setupvalue(L, -2, i);
+	}
+
+	lua_pop(L, 1);
+}
+
+ParallelScripts::Worker& ParallelScripts::assign(const Job& job) {
+	const auto address = reinterpret_cast<uintptr_t>(job.node);
+	Worker& worker = *m_workers[(address / alignof(_SceneNode)) % m_workers.size()];
+
+	const Script& script = *job.script;
+
+	auto it = worker.scripts.find(script.getId());
+	const bool known = it != worker.scripts.end();
+
+	if (known && it->second.revision == script.getRevision()) {
+		return worker;
+	}
+
+	sol::load_result chunk =
+		worker.lua.load(script.m_info.parallelCode, script.m_info.name,
+						sol::load_mode::binary);
+
+	WorkerScript& workerScript = worker.scripts[script.getId()];
+	workerScript.revision = script.getRevision();
+	workerScript.update = sol::protected_function{};
+
+	if (chunk.valid()) {
+		workerScript.update = chunk;
+		bindUpvalues(workerScript.update);
+	} else {
+		sol::error err = chunk;
+		std::cerr << "Error loading parallel script: " << err.what() << std::endl;
+	}
+
+	// a reloaded script keeps the data of the worker
+	if (known) {
+		return worker;
+	}
+
+	sol::object data = copyValue(script.m_info.data, worker.lua);
+
+	workerScript.data = data.is<sol::table>() ? data.as<sol::table>()
+											  : worker.lua.create_table();
+
+	return worker;
+}
+
+void ParallelScripts::run(const std::vector<Job>& jobs) {
+	if (jobs.empty()) {
+		return;
+	}
+
+	if (m_workers.empty()) {
+		init();
+	}
+
+	for (auto& worker : m_workers) {
+		worker->jobs.clear();
+		worker->commands.clear();
+	}
+
+	// scripts are loaded in workers here, while the main state can be read
+	for (const Job& job : jobs) {
+		assign(job).jobs.push_back(job);
+	}
+
+	{
+		std::lock_guard lock(m_mutex);
+		m_pending = m_workers.size();
+		m_generation++;
+	}
+
+	m_start.notify_all();
+
+	{
+		std::unique_lock lock(m_mutex);
+		m_done.wait(lock, [this] { return m_pending == 0; });
+	}
+
+	// sync point
+	for (const auto& worker : m_workers) {
+		for (const auto& command : worker->commands) {
+			command.node->updateTransform(command.transform);
+		}
+	}
+}
+
+void ParallelScripts::work(Worker& worker) {
+	uint64_t generation = 0;
+
+	trace::setThreadName("parallel scripts");
+
+	while (true) {
+		{
+			std::unique_lock lock(m_mutex);
+
+			m_start.wait(lock,
+						 [&] { return m_stop || m_generation != generation; });
+
+			if (m_stop) {
+				return;
+			}
+
+			generation = m_generation;
+		}
+
+		{
+			trace::Scope scope{"jobs", "parallel"};
+			runJobs(worker);
+		}
+
+		{
+			std::lock_guard lock(m_mutex);
+
+			if (--m_pending == 0) {
+				m_done.notify_one();
+			}
+		}
+	}
+}
+
+void ParallelScripts::runJobs(Worker& worker) {
+	for (const Job& job : worker.jobs) {
+		WorkerScript& script = worker.scripts[job.script->getId()];
+
+		if (!script.update.valid()) {
+			continue;
+		}
+
+		Node node{job.node, job.node->getTransform(), &worker.commands};
+
+		sol::protected_function_result result =
+			script.update(job.dt, &node, script.data);
+
+		if (!result.valid()) {
+			sol::error err = result;
+			std::cerr << "Error in parallel update: " << err.what() << std::endl;
+		}
+	}
+}
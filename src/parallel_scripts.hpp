@@ -0,0 +1,87 @@
+#pragma once
+
+#include <condition_variable>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include "etna/transform.hpp"
+#include "script.hpp"
+
+namespace etna {
+
+// Note 1: every worker owns a lua state, and a copy of the data of the scripts it
+// runs, taken the first time it runs them. Nodes always go to the same worker, but
+// the data of a script shared by nodes on different workers is not shared anymore
+// Note 2: workers can't touch the scene, transforms are written through a command
+// buffer which is applied at the sync point, after all workers are done
+// Note 3: update functions are moved to workers as bytecode, so their upvalues
+// (other than the globals) are lost
+class ParallelScripts {
+public:
+	struct Job {
+		_SceneNode* node;
+		Script* script;
+		float dt;
+	};
+
+	ParallelScripts() = default;
+
+	~ParallelScripts();
+
+	void run(const std::vector<Job>&);
+
+	// math.random of every worker, from seed plus the index of the worker
+	// Note: a node goes to a worker by its address, so the draws a script gets
+	// also depend on which nodes share its worker
+	void seed(int64_t seed);
+
+	uint32_t getWorkerCount() const { return m_workers.size(); }
+
+private:
+	struct TransformCommand {
+		_SceneNode* node;
+		Transform transform;
+	};
+
+	struct Node;
+
+	struct WorkerScript {
+		sol::protected_function update;
+		sol::table data;
+		uint32_t revision{0};
+	};
+
+	struct Worker {
+		sol::state lua;
+		std::thread thread;
+		std::vector<Job> jobs;
+		std::vector<TransformCommand> commands;
+		std::unordered_map<uint32_t, WorkerScript> scripts;
+	};
+
+	std::vector<std::unique_ptr<Worker>> m_workers;
+
+	std::mutex m_mutex;
+	std::condition_variable m_start;
+	std::condition_variable m_done;
+	uint64_t m_generation{0};
+	uint32_t m_pending{0};
+	bool m_stop{false};
+	std::optional<int64_t> m_seed;
+
+	void init();
+
+	Worker& assign(const Job&);
+
+	void work(Worker&);
+
+	void runJobs(Worker&);
+
+public:
+	ParallelScripts(const ParallelScripts&) = delete;
+	ParallelScripts& operator=(const ParallelScripts&) = delete;
+	ParallelScripts(ParallelScripts&&) = delete;
+	ParallelScripts& operator=(ParallelScripts&&) = delete;
+};
+
+}  // namespace etna
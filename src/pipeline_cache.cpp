@@ -0,0 +1,269 @@
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <vulkan/vulkan_core.h>
+#include "gpu_profiler.hpp"
+#include "pipeline_cache.hpp"
+#include "vulkan_loader.hpp"
+
+using namespace etna;
+
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+struct CacheState {
+	std::mutex mutex;
+	VkDevice device{VK_NULL_HANDLE};
+	VkPipelineCache cache{VK_NULL_HANDLE};
+	VkPhysicalDeviceProperties properties{};
+	std::string path;
+	pipeline_cache::Stats stats;
+};
+
+CacheState g_state;
+
+}  // namespace
+
+static std::string getCacheDir() {
+	if (const char* dir = std::getenv("Y3_CACHE_DIR")) {
+		return dir;
+	}
+
+	if (const char* dir = std::getenv("XDG_CACHE_HOME")) {
+		return std::string{dir} + "/y3";
+	}
+
+	if (const char* home = std::getenv("HOME")) {
+		return std::string{home} + "/.cache/y3";
+	}
+
+	return ".y3cache";
+}
+
+static std::string getCachePath(const VkPhysicalDeviceProperties& properties) {
+	static constexpr char digits[] = "0123456789abcdef";
+
+	std::string uuid;
+
+	for (uint8_t byte : properties.pipelineCacheUUID) {
+		uuid += digits[byte >> 4];
+		uuid += digits[byte & 15];
+	}
+
+	return getCacheDir() + "/pipelines-" + uuid + ".bin";
+}
+
+// Note: drivers should reject foreign data themselves, but not all of them do
+static bool isCompatible(const std::vector<char>& data,
+						 const VkPhysicalDeviceProperties& properties) {
+	VkPipelineCacheHeaderVersionOne header;
+
+	if (data.size() < sizeof(header)) {
+		return false;
+	}
+
+	std::memcpy(&header, data.data(), sizeof(header));
+
+	return header.headerSize >= sizeof(header) &&
+		   header.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE &&
+		   header.vendorID == properties.vendorID &&
+		   header.deviceID == properties.deviceID &&
+		   std::memcmp(header.pipelineCacheUUID, properties.pipelineCacheUUID,
+					   VK_UUID_SIZE) == 0;
+}
+
+static std::vector<char> readCache(const std::string& path) {
+	std::ifstream file{path, std::ios::binary};
+
+	if (!file) {
+		return {};
+	}
+
+	return {std::istreambuf_iterator<char>{file}, std::istreambuf_iterator<char>{}};
+}
+
+static void createCache(VkDevice device, VkPhysicalDevice physicalDevice) {
+	vkGetPhysicalDeviceProperties(physicalDevice, &g_state.properties);
+
+	g_state.path = getCachePath(g_state.properties);
+
+	std::vector<char> data = readCache(g_state.path);
+
+	if (!data.empty() && !isCompatible(data, g_state.properties)) {
+		std::cerr << "Warning: ignoring incompatible pipeline cache " << g_state.path
+				  << '\n';
+		data.clear();
+	}
+
+	VkPipelineCacheCreateInfo info{
+		.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO,
+		.initialDataSize = data.size(),
+		.pInitialData = data.data(),
+	};
+
+	VkResult result = vkCreatePipelineCache(device, &info, nullptr, &g_state.cache);
+
+	if (result != VK_SUCCESS && !data.empty()) {
+		data.clear();
+		info.initialDataSize = 0;
+		info.pInitialData = nullptr;
+
+		result = vkCreatePipelineCache(device, &info, nullptr, &g_state.cache);
+	}
+
+	if (result != VK_SUCCESS) {
+		std::cerr << "Warning: pipeline cache disabled, creation failed\n";
+		g_state.cache = VK_NULL_HANDLE;
+		return;
+	}
+
+	g_state.device = device;
+	g_state.stats.warm = !data.empty();
+	g_state.stats.loadedBytes = data.size();
+}
+
+static void saveCache() {
+	if (g_state.cache == VK_NULL_HANDLE) {
+		return;
+	}
+
+	size_t size = 0;
+
+	if (vkGetPipelineCacheData(g_state.device, g_state.cache, &size, nullptr) !=
+			VK_SUCCESS ||
+		size == 0) {
+		return;
+	}
+
+	std::vector<char> data(size);
+
+	if (vkGetPipelineCacheData(g_state.device, g_state.cache, &size, data.data()) !=
+		VK_SUCCESS) {
+		return;
+	}
+
+	// written next to the cache then renamed, so a crash can't leave half a file
+	std::error_code error;
+	const std::filesystem::path path{g_state.path};
+	std::filesystem::create_directories(path.parent_path(), error);
+
+	const std::string tmpPath = g_state.path + ".tmp";
+
+	{
+		std::ofstream file{tmpPath, std::ios::binary | std::ios::trunc};
+		file.write(data.data(), static_cast<std::streamsize>(size));
+
+		if (!file) {
+			std::cerr << "Warning: couldn't write pipeline cache " << tmpPath
+					  << '\n';
+			return;
+		}
+	}
+
+	std::filesystem::rename(tmpPath, path, error);
+
+	if (error) {
+		std::cerr << "Warning: couldn't write pipeline cache " << g_state.path
+				  << ": " << error.message() << '\n';
+	}
+}
+
+pipeline_cache::Stats pipeline_cache::getStats() {
+	std::lock_guard lock{g_state.mutex};
+	return g_state.stats;
+}
+
+void pipeline_cache::save() {
+	std::lock_guard lock{g_state.mutex};
+	saveCache();
+}
+
+// interposed vulkan entry points
+
+VKAPI_ATTR VkResult VKAPI_CALL
+vkCreateDevice(VkPhysicalDevice physicalDevice,
+			   const VkDeviceCreateInfo* pCreateInfo,
+			   const VkAllocationCallbacks* pAllocator,
+			   VkDevice* pDevice) {
+	static const auto next = getLoaderFunction<PFN_vkCreateDevice>("vkCreateDevice");
+
+	// the GPU profiler resets its queries from the host
+	GpuProfiler::DeviceFeatures features;
+	const VkDeviceCreateInfo createInfo = GpuProfiler::enableDeviceFeatures(
+		physicalDevice, *pCreateInfo, features);
+
+	const VkResult result = next(physicalDevice, &createInfo, pAllocator, pDevice);
+
+	std::lock_guard lock{g_state.mutex};
+
+	// PONDER: only the first device gets a cache, etna never creates a second one
+	if (result == VK_SUCCESS && g_state.device == VK_NULL_HANDLE) {
+		createCache(*pDevice, physicalDevice);
+	}
+
+	return result;
+}
+
+VKAPI_ATTR void VKAPI_CALL vkDestroyDevice(VkDevice device,
+										   const VkAllocationCallbacks* pAllocator) {
+	static const auto next =
+		getLoaderFunction<PFN_vkDestroyDevice>("vkDestroyDevice");
+
+	{
+		std::lock_guard lock{g_state.mutex};
+
+		if (device != VK_NULL_HANDLE && device == g_state.device) {
+			saveCache();
+
+			if (g_state.cache != VK_NULL_HANDLE) {
+				vkDestroyPipelineCache(device, g_state.cache, nullptr);
+			}
+
+			g_state.cache = VK_NULL_HANDLE;
+			g_state.device = VK_NULL_HANDLE;
+		}
+	}
+
+	next(device, pAllocator);
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL
+vkCreateGraphicsPipelines(VkDevice device,
+						  VkPipelineCache pipelineCache,
+						  uint32_t createInfoCount,
+						  const VkGraphicsPipelineCreateInfo* pCreateInfos,
+						  const VkAllocationCallbacks* pAllocator,
+						  VkPipeline* pPipelines) {
+	static const auto next = getLoaderFunction<PFN_vkCreateGraphicsPipelines>(
+		"vkCreateGraphicsPipelines");
+
+	// Note: the driver synchronizes access to the cache itself
+	if (pipelineCache == VK_NULL_HANDLE) {
+		std::lock_guard lock{g_state.mutex};
+
+		if (device == g_state.device) {
+			pipelineCache = g_state.cache;
+		}
+	}
+
+	const auto start = Clock::now();
+
+	const VkResult result = next(device, pipelineCache, createInfoCount,
+								 pCreateInfos, pAllocator, pPipelines);
+
+	const std::chrono::duration<float> time = Clock::now() - start;
+
+	std::lock_guard lock{g_state.mutex};
+	g_state.stats.pipelines += createInfoCount;
+	g_state.stats.createTime += time.count();
+
+	return result;
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Note: etna creates its device and pipelines without a VkPipelineCache, so the
+// calls are interposed in pipeline_cache.cpp and a cache is slipped in. It's stored
+// per pipelineCacheUUID under $Y3_CACHE_DIR, $XDG_CACHE_HOME/y3 or ~/.cache/y3
+namespace etna::pipeline_cache {
+
+struct Stats {
+	bool warm{false};  // valid data was loaded from disk
+	size_t loadedBytes{0};
+	uint32_t pipelines{0};
+	float createTime{0};  // seconds spent in vkCreateGraphicsPipelines
+};
+
+Stats getStats();
+
+// writes the cache to disk, also done when the device is destroyed
+void save();
+
+}  // namespace etna::pipeline_cache
@@ -0,0 +1,201 @@
+#include <algorithm>
+#include <iostream>
+#include "gpu_memory.hpp"
+#include "y3.hpp"
+
+using namespace etna;
+
+// times in milliseconds, by phase name
+sol::table y3::getFrameStats(uint32_t frames) {
+	const auto stats = m_profiler.getStats(frames);
+	sol::table table = m_lua.create_table();
+
+	for (size_t i = 0; i < stats.size(); i++) {
+		const FrameProfiler::Stats& phase = stats[i];
+
+		table[FrameProfiler::getName(i)] =
+			m_lua.create_table_with("min", phase.min * 1000,  //
+									"avg", phase.avg * 1000,  //
+									"p99", phase.p99 * 1000,  //
+									"max", phase.max * 1000);
+	}
+
+	table["frames"] = std::min(frames, m_profiler.getFrameCount());
+
+	return table;
+}
+
+std::vector<ScriptHandle> y3::getTopScripts(size_t count) {
+	std::vector<ScriptHandle> scripts;
+
+	for (const auto& weak : m_scripts) {
+		ScriptHandle script = weak.lock();
+
+		if (script != nullptr && script->getTotalTime() > 0) {
+			scripts.push_back(script);
+		}
+	}
+
+	count = std::min(count, scripts.size());
+
+	std::partial_sort(scripts.begin(), scripts.begin() + count, scripts.end(),
+					  [](const ScriptHandle& a, const ScriptHandle& b) {
+						  return a->getTotalTime() > b->getTotalTime();
+					  });
+
+	scripts.resize(count);
+
+	return scripts;
+}
+
+// Note: parallel updates run on the workers and only count for the parallel phase
+void y3::printScriptStats(size_t count) {
+	const std::vector<ScriptHandle> scripts = getTopScripts(count);
+
+	std::cout << "Top scripts (ms):" << std::endl;
+
+	for (const ScriptHandle& script : scripts) {
+		std::cout << "  " << script->m_info.name << ": "
+				  << script->getTotalTime() * 1000;
+
+		for (size_t i = 0; i < static_cast<size_t>(Script::Hook::COUNT); i++) {
+			const auto hook = static_cast<Script::Hook>(i);
+			const Script::HookStats& stats = script->getHookStats(hook);
+
+			if (stats.calls > 0) {
+				std::cout << ", " << Script::getHookName(hook) << " " << stats.calls
+						  << "x max " << stats.max * 1000;
+			}
+		}
+
+		std::cout << std::endl;
+	}
+}
+
+static constexpr const char* NODE_TYPES[] = {"root", "mesh", "camera", "light"};
+
+static double toKilobytes(size_t bytes) {
+	return static_cast<double>(bytes) / 1024;
+}
+
+static double toMegabytes(size_t bytes) {
+	return static_cast<double>(bytes) / (1024 * 1024);
+}
+
+// sizes in kilobytes
+sol::table y3::getResourceStats() {
+	const gpu_memory::Stats memory = gpu_memory::getStats();
+
+	sol::table buffers = m_lua.create_table();
+	gpu_memory::Usage total;
+
+	for (size_t i = 0; i < memory.buffers.size(); i++) {
+		const gpu_memory::Usage& usage = memory.buffers[i];
+
+		buffers[gpu_memory::getOwnerName(static_cast<gpu_memory::Owner>(i))] =
+			m_lua.create_table_with("count", usage.count,  //
+									"kb", toKilobytes(usage.bytes));
+
+		total.count += usage.count;
+		total.bytes += usage.bytes;
+	}
+
+	buffers["total"] = m_lua.create_table_with("count", total.count,  //
+											   "kb", toKilobytes(total.bytes));
+
+	sol::table nodes = m_lua.create_table();
+	size_t nodeCount = 0;
+
+	for (size_t i = 0; i < _SceneNode::TYPE_COUNT; i++) {
+		const size_t count = _SceneNode::g_liveCount[i].load();
+
+		nodes[NODE_TYPES[i]] = count;
+		nodeCount += count;
+	}
+
+	nodes["total"] = nodeCount;
+
+	sol::table deviceMemory =
+		m_lua.create_table_with("count", memory.memory.count,  //
+								"kb", toKilobytes(memory.memory.bytes));
+
+	return m_lua.create_table_with(
+		"buffers", buffers,							 //
+		"device_memory", deviceMemory,				 //
+		"nodes", nodes,								 //
+		"lua_kb", toKilobytes(m_lua.memory_used()),  //
+		"scenes", m_scenes.size());
+}
+
+// one line, for logs
+void y3::printResourceStats() {
+	const gpu_memory::Stats memory = gpu_memory::getStats();
+
+	gpu_memory::Usage total;
+
+	for (const gpu_memory::Usage& usage : memory.buffers) {
+		total.count += usage.count;
+		total.bytes += usage.bytes;
+	}
+
+	std::cout << "Resources: buffers " << toMegabytes(total.bytes) << " MB in "
+			  << total.count << " (";
+
+	for (size_t i = 0; i < memory.buffers.size(); i++) {
+		std::cout << (i > 0 ? ", " : "")
+				  << gpu_memory::getOwnerName(static_cast<gpu_memory::Owner>(i))
+				  << ' ' << memory.buffers[i].count;
+	}
+
+	std::cout << ") | device " << toMegabytes(memory.memory.bytes) << " MB in "
+			  << memory.memory.count << " | nodes";
+
+	for (size_t i = 0; i < _SceneNode::TYPE_COUNT; i++) {
+		std::cout << ' ' << NODE_TYPES[i] << ' '
+				  << _SceneNode::g_liveCount[i].load();
+	}
+
+	std::cout << " | lua " << toMegabytes(m_lua.memory_used()) << " MB, "
+			  << m_luaAllocator.getStats().frameAllocations << " allocs/frame"
+			  << " | scenes " << m_scenes.size() << std::endl;
+}
+
+sol::table y3::getLuaAllocStats() {
+	const LuaAllocator::Stats stats = m_luaAllocator.getStats();
+
+	// by the largest size in the class, 0 for the blocks over MAX_POOLED
+	sol::table classes = m_lua.create_table();
+
+	for (size_t i = 0; i < stats.classes.size(); i++) {
+		const LuaAllocator::ClassStats& sizeClass = stats.classes[i];
+		const size_t size =
+			i < LuaAllocator::CLASS_COUNT ? (i + 1) * LuaAllocator::GRANULARITY : 0;
+
+		classes[i + 1] =
+			m_lua.create_table_with("size", size,							 //
+									"allocations", sizeClass.allocations,  //
+									"kb", toKilobytes(sizeClass.liveBytes));
+	}
+
+	return m_lua.create_table_with(
+		"pooling", stats.pooling,					 //
+		"allocations", stats.allocations,			 //
+		"frees", stats.frees,						 //
+		"frame_allocations", stats.frameAllocations,  //
+		"kb", toKilobytes(stats.liveBytes),			 //
+		"arena_kb", toKilobytes(stats.arenaBytes),	 //
+		"classes", classes);
+}
+
+void y3::updateStatsLog() {
+	if (m_statsInterval <= 0) {
+		return;
+	}
+
+	const auto now = Clock::now();
+
+	if (now - m_lastStatsLog >= std::chrono::duration<float>(m_statsInterval)) {
+		printResourceStats();
+		m_lastStatsLog = now;
+	}
+}
@@ -0,0 +1,124 @@
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include "y3.hpp"
+
+using namespace etna;
+
+void y3::recordInput(const std::string& path) {
+	const auto seed = static_cast<int64_t>(std::random_device{}());
+
+	m_inputRecording.record(path, seed);
+	m_lua["math"]["randomseed"](seed);
+	m_parallelScripts.seed(seed);
+
+	std::cout << "Recording input to " << path << std::endl;
+}
+
+void y3::replayInput(const std::string& path, const std::string& timesPath) {
+	const int64_t seed = m_inputRecording.replay(path);
+	m_lua["math"]["randomseed"](seed);
+	m_parallelScripts.seed(seed);
+
+	// the frame times measure the code rather than a frame cap
+	if (m_loopSettings.maxFps > 0) {
+		m_loopSettings.maxFps = 0;
+		std::cout << "Replay: frame limiter off" << std::endl;
+	}
+
+	m_replayTimes.clear();
+	m_replayTimes.reserve(m_inputRecording.getFrameCount());
+	m_replayTimesPath = timesPath;
+
+	std::cout << "Replaying " << m_inputRecording.getFrameCount()
+			  << " frames of input from " << path << std::endl;
+}
+
+void y3::stopInputRecording() {
+	m_inputRecording.stop();
+}
+
+bool y3::updateInput(float& dt) {
+	switch (m_inputRecording.getMode()) {
+		case InputRecording::Mode::OFF:
+			m_input.update(*g_window);
+			break;
+
+		// the sample rather than the snapshot, whose deltas may add up frames
+		case InputRecording::Mode::RECORD: {
+			const InputSnapshot sample = InputDispatcher::sample(*g_window);
+
+			m_input.update(sample);
+			m_inputRecording.write(dt, sample);
+			break;
+		}
+
+		case InputRecording::Mode::REPLAY: {
+			const InputRecording::Frame* frame = m_inputRecording.read();
+
+			if (frame == nullptr) {
+				return false;
+			}
+
+			m_input.update(InputSnapshot{
+				.down = frame->down,
+				.mouseX = frame->mouseX,
+				.mouseY = frame->mouseY,
+				.mouseDeltaX = frame->mouseDeltaX,
+				.mouseDeltaY = frame->mouseDeltaY,
+			});
+
+			dt = frame->dt;
+			break;
+		}
+	}
+
+	m_dt = dt;
+
+	return true;
+}
+
+// Note: the first frames include loading the scene, compare the distributions
+// rather than the maximums
+void y3::finishReplay() {
+	m_inputRecording.stop();
+
+	if (m_replayTimes.empty()) {
+		return;
+	}
+
+	std::vector<float> times = m_replayTimes;
+	std::sort(times.begin(), times.end());
+
+	float sum = 0;
+
+	for (float time : times) {
+		sum += time;
+	}
+
+	const auto percentile = [&](size_t p) {
+		return times[(times.size() - 1) * p / 100] * 1000;
+	};
+
+	std::cout << "Replay: " << times.size() << " frames (ms) avg "
+			  << sum / times.size() * 1000 << ", min " << times.front() * 1000
+			  << ", p50 " << percentile(50) << ", p99 " << percentile(99)
+			  << ", max " << times.back() * 1000 << std::endl;
+
+	if (m_replayTimesPath.empty()) {
+		return;
+	}
+
+	std::ofstream out{m_replayTimesPath};
+
+	if (!out) {
+		std::cerr << "Error in replay: can't write " << m_replayTimesPath
+				  << std::endl;
+		return;
+	}
+
+	for (float time : m_replayTimes) {
+		out << time * 1000 << '\n';
+	}
+}
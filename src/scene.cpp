@@ -1,28 +1,43 @@
 #include "scene.hpp"
 #include "etna/default_materials.hpp"
 #include "etna/engine.hpp"
+#include "gpu_memory.hpp"
+#include "trace.hpp"
 
 using namespace etna;
 using namespace ignis;
 
 static MaterialHandle g_defaultMaterial = nullptr;
 
-Scene::Scene()
-	: m_sceneBuffer(_device.createUBO(sizeof(SceneData))),
-	  m_lightsBuffer(
-		  _device.createUBO(sizeof(ignis::BufferId) * Scene::MAX_LIGHTS)) {
-	if (g_defaultMaterial == nullptr) {
-		g_defaultMaterial = engine::createColorMaterial(WHITE);
+Scene::Scene() = default;
 
-		engine::queueForDeletion([] { g_defaultMaterial.reset(); });
+Scene::~Scene() {
+	applyDestroyScripts();
+
+	if (m_sceneBuffer != IGNIS_INVALID_BUFFER_ID) {
+		_device.destroyBuffer(m_sceneBuffer);
+		_device.destroyBuffer(m_lightsBuffer);
 	}
 }
 
-Scene::~Scene() {
-	applyDestroyScripts();
+// Note: buffers are made by the first render or light, scenes that are only
+// updated (benchmarks, preloads not shown yet) never touch the device
+void Scene::createBuffers() {
+	if (m_sceneBuffer != IGNIS_INVALID_BUFFER_ID) {
+		return;
+	}
+
+	gpu_memory::OwnerScope owner{gpu_memory::Owner::SCENE};
+
+	m_sceneBuffer = _device.createUBO(sizeof(SceneData));
+	m_lightsBuffer = _device.createUBO(sizeof(ignis::BufferId) * MAX_LIGHTS);
+
+	if (g_defaultMaterial == nullptr) {
+		gpu_memory::OwnerScope materialOwner{gpu_memory::Owner::MATERIAL};
+		g_defaultMaterial = engine::createColorMaterial(WHITE);
 
-	_device.destroyBuffer(m_sceneBuffer);
-	_device.destroyBuffer(m_lightsBuffer);
+		engine::queueForDeletion([] { g_defaultMaterial.reset(); });
+	}
 }
 
 SceneNode Scene::addNode(SceneNode node) {
@@ -47,6 +62,7 @@ SceneNode Scene::addNode(SceneNode node) {
 		}
 
 		if (lights.size() > 0) {
+			createBuffers();
 			_device.updateBuffer(m_lightsBuffer, lights.data());
 		}
 	}
@@ -145,6 +161,18 @@ const std::vector<MeshNode>& Scene::getMeshes() const {
 	return m_meshCache;
 }
 
+// PONDER: light data is private to etna, this mirrors its layout
+size_t Scene::getBufferBytes() const {
+	constexpr size_t lightBytes = sizeof(Vec3) + sizeof(float) + sizeof(Color);
+
+	if (m_sceneBuffer == IGNIS_INVALID_BUFFER_ID) {
+		return 0;
+	}
+
+	return sizeof(SceneData) + sizeof(ignis::BufferId) * MAX_LIGHTS +
+		   getLights().size() * lightBytes;
+}
+
 const std::vector<CameraNode> Scene::getCameras() const {
 	std::vector<CameraNode> cameras;
 
@@ -174,6 +202,8 @@ const std::vector<LightNode>& Scene::getLights() const {
 }
 
 void Scene::render(Renderer& renderer, const SceneRenderInfo& info) {
+	createBuffers();
+
 	const SceneData sceneData{
 		.ambient = info.ambient,
 		.lights = m_lightsBuffer,
@@ -182,6 +212,10 @@ void Scene::render(Renderer& renderer, const SceneRenderInfo& info) {
 
 	_device.updateBuffer(m_sceneBuffer, &sceneData);
 
+	GpuProfiler* gpu = info.gpuProfiler != nullptr && info.gpuProfiler->isTiming()
+						   ? info.gpuProfiler
+						   : nullptr;
+
 	for (const auto& cameraNode : getCameras()) {
 		RenderTarget* target = cameraNode->renderTarget;
 		Viewport vp{cameraNode->viewport};
@@ -189,7 +223,17 @@ void Scene::render(Renderer& renderer, const SceneRenderInfo& info) {
 		if (target == nullptr)
 			continue;
 
-		renderer.beginFrame(*target);
+		const std::string cameraName = cameraNode->getName();
+		trace::Scope cameraScope{cameraName, "camera"};
+
+		{
+			trace::Scope scope{"begin_frame", "renderer"};
+			renderer.beginFrame(*target);
+		}
+
+		if (gpu != nullptr) {
+			gpu->beginPass(renderer.getCommand().getHandle(), cameraName);
+		}
 
 		if (vp.width == 0) {
 			vp.x = 0;
@@ -203,13 +247,34 @@ void Scene::render(Renderer& renderer, const SceneRenderInfo& info) {
 
 		cameraNode->camera->updateAspect(vp.width / vp.height);
 
+		// put back by storeWorldMatrices
+		if (info.interpolation < 1) {
+			cameraNode->camera->updateTransform(
+				cameraNode->getWorldMatrix(info.interpolation));
+		}
+
+		// for the GPU profiler, a batch lasts until the material changes
+		MaterialHandle batchMaterial = nullptr;
+		uint32_t batchDraws = 0;
+
 		for (const auto& meshNode : getMeshes()) {
 			if (meshNode->mesh == nullptr)
 				continue;
 
 			const MaterialHandle material = meshNode->material;
+
+			if (gpu != nullptr && material != batchMaterial) {
+				if (batchDraws > 0) {
+					gpu->endBatch(renderer.getCommand().getHandle(), batchDraws);
+				}
+
+				batchMaterial = material;
+				batchDraws = 0;
+			}
+
+			batchDraws++;
 			const MeshHandle mesh = meshNode->mesh;
-			const Mat4 worldMatrix = meshNode->getWorldMatrix();
+			const Mat4 worldMatrix = meshNode->getWorldMatrix(info.interpolation);
 
 			renderer.draw({
 				.mesh = mesh,
@@ -223,13 +288,44 @@ void Scene::render(Renderer& renderer, const SceneRenderInfo& info) {
 			});
 		}
 
+		if (gpu != nullptr) {
+			if (batchDraws > 0) {
+				gpu->endBatch(renderer.getCommand().getHandle(), batchDraws);
+			}
+
+			gpu->endPass(renderer.getCommand().getHandle());
+		}
+
+		trace::Scope scope{"end_frame", "renderer"};
 		renderer.endFrame();
 	}
 }
 
-void Scene::applyUpdateScripts() {
+void Scene::applyUpdateScripts(float dt, uint64_t frame) {
+	m_parallelQueue.clear();
+
+	for (const auto& [_, root] : m_roots) {
+		root->applyUpdateScripts(this, dt, frame);
+	}
+}
+
+void Scene::applyFixedUpdateScripts(float dt) {
 	for (const auto& [_, root] : m_roots) {
-		root->applyUpdateScripts(this);
+		root->applyFixedUpdateScripts(this, dt);
+	}
+}
+
+// Note: only what's drawn is stored, lights aren't interpolated
+void Scene::storeWorldMatrices() {
+	for (const auto& meshNode : getMeshes()) {
+		meshNode->storeWorldMatrix();
+	}
+
+	for (const auto& cameraNode : getCameras()) {
+		cameraNode->storeWorldMatrix();
+
+		// the last render left the camera between two steps
+		cameraNode->camera->updateTransform(cameraNode->getWorldMatrix());
 	}
 }
 
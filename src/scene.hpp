@@ -2,12 +2,18 @@
 
 #include <unordered_map>
 #include "scene_graph.hpp"
+#include "parallel_scripts.hpp"
+#include "gpu_profiler.hpp"
 #include "etna/renderer.hpp"
 
 namespace etna {
 
 struct SceneRenderInfo {
 	Color ambient{WHITE};
+	GpuProfiler* gpuProfiler{nullptr};
+
+	// between the stored world matrices (0) and the current ones (1)
+	float interpolation{1};
 };
 
 class Scene {
@@ -33,7 +39,21 @@ public:
 
 	void applyStartScripts();
 
-	void applyUpdateScripts();
+	void applyUpdateScripts(float dt, uint64_t frame);
+
+	void applyFixedUpdateScripts(float dt);
+
+	// before a step of the fixed loop, for the interpolation of the next render
+	void storeWorldMatrices();
+
+	// parallel scripts are only queued by the update, y3 runs them afterwards
+	void queueParallelUpdate(const ParallelScripts::Job& job) {
+		m_parallelQueue.push_back(job);
+	}
+
+	const std::vector<ParallelScripts::Job>& getParallelQueue() const {
+		return m_parallelQueue;
+	}
 
 	void applySleepScripts();
 
@@ -50,11 +70,15 @@ public:
 
 	void print() const;
 
+	// buffers the scene and its lights own, without the meshes and materials
+	size_t getBufferBytes() const;
+
 private:
 	std::unordered_map<std::string, SceneNode> m_roots;
 
 	void addNodeHelper(SceneNode node, const Transform& transform);
 	void updateLights();
+	void createBuffers();
 
 	ignis::BufferId m_sceneBuffer{IGNIS_INVALID_BUFFER_ID};
 	ignis::BufferId m_lightsBuffer{IGNIS_INVALID_BUFFER_ID};
@@ -66,6 +90,8 @@ private:
 	mutable bool m_lightCacheDirty{true};
 	mutable std::vector<LightNode> m_lightCache;
 
+	std::vector<ParallelScripts::Job> m_parallelQueue;
+
 	struct SceneData {
 		Color ambient;
 		ignis::BufferId lights;
@@ -0,0 +1,478 @@
+#include <filesystem>
+#include <fstream>
+#include <span>
+#include <unordered_set>
+#include "baked_scene.hpp"
+#include "mapped_file.hpp"
+#include "y3.hpp"
+
+namespace fs = std::filesystem;
+using namespace etna;
+
+// cameras are copied to and from the baked floats as they are
+static_assert(sizeof(Camera::CreateInfo) == sizeof(baked::Node::camera));
+static_assert(sizeof(Viewport) == sizeof(baked::Node::viewport));
+
+static std::string getBakedPath(const std::string& name) {
+	return fs::current_path().string() + "/" + name + ".y3b";
+}
+
+struct BakeWriter {
+	std::vector<baked::Module> modules;
+	std::vector<baked::Asset> assets;
+	std::vector<baked::Node> nodes;
+	std::vector<baked::Span> scripts;
+	std::string blob;
+
+	std::unordered_map<AssetCache::Key, int32_t> assetIndices;
+
+	baked::Span addString(std::string_view str) {
+		const baked::Span span{
+			.offset = static_cast<uint32_t>(blob.size()),
+			.size = static_cast<uint32_t>(str.size()),
+		};
+
+		blob.append(str);
+
+		return span;
+	}
+
+	template <typename T>
+	static baked::Span appendArray(std::string& file, const std::vector<T>& items) {
+		// aligned, so that the arrays can be read in place
+		file.resize((file.size() + alignof(T) - 1) / alignof(T) * alignof(T));
+
+		const baked::Span span{
+			.offset = static_cast<uint32_t>(file.size()),
+			.size = static_cast<uint32_t>(items.size() * sizeof(T)),
+		};
+
+		file.append(reinterpret_cast<const char*>(items.data()), span.size);
+
+		return span;
+	}
+
+	void write(const std::string& path, int64_t sourceTime) const {
+		baked::Header header{.sourceTime = sourceTime};
+
+		std::string file(sizeof(header), '\0');
+
+		header.modules = appendArray(file, modules);
+		header.assets = appendArray(file, assets);
+		header.nodes = appendArray(file, nodes);
+		header.scripts = appendArray(file, scripts);
+		header.blob = {static_cast<uint32_t>(file.size()),
+					   static_cast<uint32_t>(blob.size())};
+
+		file.append(blob);
+		std::memcpy(file.data(), &header, sizeof(header));
+
+		std::ofstream out{path, std::ios::binary};
+		out.write(file.data(), file.size());
+
+		if (!out) {
+			throw std::runtime_error{"Failed to write " + path};
+		}
+	}
+};
+
+// a mapped baked scene, every access is checked against the size of the file
+struct BakedView {
+	const char* data;
+	size_t size;
+
+	const baked::Header& getHeader() const {
+		return *reinterpret_cast<const baked::Header*>(data);
+	}
+
+	template <typename T>
+	std::span<const T> getArray(baked::Span span) const {
+		if (size_t{span.offset} + span.size > size || span.size % sizeof(T) != 0 ||
+			span.offset % alignof(T) != 0) {
+			throw std::runtime_error{"corrupted file"};
+		}
+
+		return {reinterpret_cast<const T*>(data + span.offset),
+				span.size / sizeof(T)};
+	}
+
+	std::string_view getString(baked::Span span) const {
+		const baked::Span& blob = getHeader().blob;
+
+		if (size_t{span.offset} + span.size > blob.size ||
+			size_t{blob.offset} + blob.size > size) {
+			throw std::runtime_error{"corrupted file"};
+		}
+
+		return {data + blob.offset + span.offset, span.size};
+	}
+};
+
+template <typename T>
+static std::shared_ptr<T> getBakedAsset(
+	const std::vector<std::shared_ptr<void>>& assets,
+	int32_t index) {
+	if (index < 0) {
+		return nullptr;
+	}
+
+	if (static_cast<size_t>(index) >= assets.size()) {
+		throw std::runtime_error{"corrupted file"};
+	}
+
+	return std::static_pointer_cast<T>(assets[index]);
+}
+
+static int32_t bakeAsset(BakeWriter& writer,
+						 const AssetCache& assets,
+						 AssetCache::Key key) {
+	if (auto it = writer.assetIndices.find(key); it != writer.assetIndices.end()) {
+		return it->second;
+	}
+
+	auto it = assets.getEntries().find(key);
+
+	if (it == assets.getEntries().end()) {
+		throw std::runtime_error{"asset not created through y3"};
+	}
+
+	const AssetCache::Entry& entry = it->second;
+
+	if (entry.kind == "material") {
+		// its template first
+		RecipeReader recipe{entry.recipe};
+		bakeAsset(writer, assets, recipe.read<AssetCache::Key>());
+	}
+
+	writer.assets.push_back({
+		.key = key,
+		.kind = writer.addString(entry.kind),
+		.recipe = writer.addString(entry.recipe),
+	});
+
+	return writer.assetIndices[key] = writer.assets.size() - 1;
+}
+
+static int32_t bakeAsset(BakeWriter& writer,
+						 const AssetCache& assets,
+						 const void* asset) {
+	if (asset == nullptr) {
+		return -1;
+	}
+
+	const auto key = assets.findKey(asset);
+
+	if (!key) {
+		throw std::runtime_error{"asset not created through y3"};
+	}
+
+	return bakeAsset(writer, assets, *key);
+}
+
+// Note 1: only what the scene file returns is baked, its other side effects are
+// lost, but the modules it required are required again before loading
+// Note 2: scripts are bound by name, they have to come from a module and their
+// name must be unique
+void y3::bakeScene(const std::string& name) {
+	const std::string path = getScenePath(name);
+
+	sol::table package = m_lua["package"];
+	sol::table loaded = package["loaded"];
+
+	std::unordered_set<std::string> preloaded;
+
+	for (const auto& [key, _] : loaded) {
+		preloaded.insert(key.as<std::string>());
+	}
+
+	sol::protected_function_result result = m_lua.script_file(name + ".lua");
+
+	if (!result.valid()) {
+		sol::error err = result;
+		throw std::runtime_error("Failed to load scene: " + name + ", " +
+								 err.what());
+	}
+
+	BakeWriter writer;
+
+	sol::protected_function searchPath = package["searchpath"];
+	const std::string luaPath = package["path"];
+
+	for (const auto& [key, _] : loaded) {
+		const std::string module = key.as<std::string>();
+
+		if (preloaded.contains(module)) {
+			continue;
+		}
+
+		sol::optional<std::string> modulePath = searchPath(module, luaPath);
+
+		if (!modulePath) {
+			throw std::runtime_error{"Can't bake " + name + ", module " + module +
+									 " is not a Lua file"};
+		}
+
+		writer.modules.push_back({
+			.name = writer.addString(module),
+			.path = writer.addString(*modulePath),
+			.time = getFileTime(*modulePath),
+		});
+	}
+
+	std::function<void(const SceneNode&, int32_t)> bakeNode =
+		[&](const SceneNode& node, int32_t parent) {
+			const Transform& transform = node->getTransform();
+
+			baked::Node bakedNode{
+				.type = static_cast<uint32_t>(node->getType()),
+				.parent = parent,
+				.name = writer.addString(node->getName()),
+				.position = {transform.position[0], transform.position[1],
+							 transform.position[2]},
+				.yaw = transform.yaw,
+				.pitch = transform.pitch,
+				.roll = transform.roll,
+				.scale = {transform.scale[0], transform.scale[1],
+						  transform.scale[2]},
+				.firstScript = static_cast<uint32_t>(writer.scripts.size()),
+				.scriptCount = static_cast<uint32_t>(node->getScripts().size()),
+			};
+
+			const std::string error = "Can't bake node " + node->getName() + ", ";
+
+			switch (node->getType()) {
+				case _SceneNode::Type::ROOT:
+					break;
+
+				case _SceneNode::Type::MESH: {
+					auto* mesh = static_cast<_MeshNode*>(node.get());
+					bakedNode.mesh = bakeAsset(writer, m_assets, mesh->mesh.get());
+					bakedNode.material =
+						bakeAsset(writer, m_assets, mesh->material.get());
+					break;
+				}
+
+				case _SceneNode::Type::CAMERA: {
+					auto it = m_cameraRecords.find(node.get());
+
+					if (it == m_cameraRecords.end()) {
+						throw std::runtime_error{error + "unknown camera"};
+					}
+
+					const CameraRecord& record = it->second;
+					std::memcpy(bakedNode.camera, &record.info,
+								sizeof(bakedNode.camera));
+					std::memcpy(bakedNode.viewport, &record.viewport,
+								sizeof(bakedNode.viewport));
+					break;
+				}
+
+				case _SceneNode::Type::LIGHT:
+					throw std::runtime_error{error + "lights are not supported"};
+			}
+
+			for (const ScriptHandle& script : node->getScripts()) {
+				const std::string& scriptName = script->m_info.name;
+
+				if (m_namedScripts[scriptName].lock() != script) {
+					throw std::runtime_error{error + "script " + scriptName +
+											 " doesn't have a unique name"};
+				}
+
+				if (script->m_info.source == "@" + name + ".lua") {
+					throw std::runtime_error{error + "script " + scriptName +
+											 " is defined in the scene file"};
+				}
+
+				writer.scripts.push_back(writer.addString(scriptName));
+			}
+
+			const int32_t index = writer.nodes.size();
+			writer.nodes.push_back(bakedNode);
+
+			for (const SceneNode& child : node->getChildren()) {
+				bakeNode(child, index);
+			}
+		};
+
+	sol::table sceneTable = result;
+
+	for (const auto& pair : sceneTable) {
+		sol::object obj = pair.second;
+
+		if (obj.is<SceneNode>()) {
+			bakeNode(obj.as<SceneNode>(), -1);
+		}
+	}
+
+	writer.write(getBakedPath(name), getFileTime(path));
+
+	std::cout << "Baked " << name << ": " << writer.nodes.size() << " nodes, "
+			  << writer.assets.size() << " assets, " << writer.modules.size()
+			  << " modules" << std::endl;
+}
+
+// nullptr when there is no usable baked scene, the scene is then loaded from Lua
+std::unique_ptr<Scene> y3::loadBakedScene(const std::string& name) {
+	const std::string path = getBakedPath(name);
+
+	const MappedFile file{path};
+
+	if (!file.isValid() || file.getSize() < sizeof(baked::Header)) {
+		return nullptr;
+	}
+
+	const BakedView view{file.getData(), file.getSize()};
+
+	std::unique_ptr<Scene> scene;
+
+	try {
+		const baked::Header& header = view.getHeader();
+
+		if (header.magic != baked::MAGIC || header.version != baked::VERSION) {
+			throw std::runtime_error{"unknown format"};
+		}
+
+		const auto modules = view.getArray<baked::Module>(header.modules);
+
+		bool stale = header.sourceTime != getFileTime(getScenePath(name));
+
+		for (const baked::Module& module : modules) {
+			const std::string modulePath{view.getString(module.path)};
+			stale |= module.time != getFileTime(modulePath);
+		}
+
+		if (stale) {
+			throw std::runtime_error{"older than its sources"};
+		}
+
+		sol::protected_function require = m_lua["require"];
+
+		for (const baked::Module& module : modules) {
+			const std::string moduleName{view.getString(module.name)};
+
+			sol::protected_function_result result = require(moduleName);
+
+			if (!result.valid()) {
+				sol::error err = result;
+				throw std::runtime_error{err.what()};
+			}
+		}
+
+		std::unordered_map<AssetCache::Key, std::shared_ptr<void>> created;
+		std::vector<std::shared_ptr<void>> assets;
+
+		for (const auto& asset : view.getArray<baked::Asset>(header.assets)) {
+			const std::string kind{view.getString(asset.kind)};
+			const std::string_view recipe = view.getString(asset.recipe);
+
+			assets.push_back(createAsset(kind, recipe, created));
+			created[asset.key] = assets.back();
+		}
+
+		const auto scriptNames = view.getArray<baked::Span>(header.scripts);
+
+		std::vector<SceneNode> nodes;
+		std::vector<SceneNode> roots;
+
+		for (const auto& bakedNode : view.getArray<baked::Node>(header.nodes)) {
+			const std::string nodeName{view.getString(bakedNode.name)};
+
+			const Transform transform{
+				.position = {bakedNode.position[0], bakedNode.position[1],
+							 bakedNode.position[2]},
+				.yaw = bakedNode.yaw,
+				.pitch = bakedNode.pitch,
+				.roll = bakedNode.roll,
+				.scale = {bakedNode.scale[0], bakedNode.scale[1],
+						  bakedNode.scale[2]},
+			};
+
+			if (size_t{bakedNode.firstScript} + bakedNode.scriptCount >
+				scriptNames.size()) {
+				throw std::runtime_error{"corrupted file"};
+			}
+
+			std::vector<ScriptHandle> scripts;
+
+			for (uint32_t i = 0; i < bakedNode.scriptCount; i++) {
+				const std::string scriptName{
+					view.getString(scriptNames[bakedNode.firstScript + i])};
+
+				ScriptHandle script = m_namedScripts[scriptName].lock();
+
+				if (script == nullptr) {
+					throw std::runtime_error{"script " + scriptName + " not found"};
+				}
+
+				scripts.push_back(script);
+			}
+
+			SceneNode node;
+
+			switch (static_cast<_SceneNode::Type>(bakedNode.type)) {
+				case _SceneNode::Type::ROOT:
+					node = scene::createRoot(nodeName, transform);
+
+					for (const ScriptHandle& script : scripts) {
+						node->addScript(script);
+					}
+					break;
+
+				case _SceneNode::Type::MESH: {
+					const int32_t material = bakedNode.material;
+
+					node = scene::createMeshNode({
+						.name = nodeName,
+						.mesh = getBakedAsset<Mesh>(assets, bakedNode.mesh),
+						.material = getBakedAsset<Material>(assets, material),
+						.transform = transform,
+						.scripts = scripts,
+					});
+					break;
+				}
+
+				case _SceneNode::Type::CAMERA: {
+					scene::CameraNodeCreateInfo cameraInfo{
+						.name = nodeName,
+						.renderTarget = g_window,
+						.transform = transform,
+						.scripts = scripts,
+					};
+
+					std::memcpy(&cameraInfo.cameraInfo, bakedNode.camera,
+								sizeof(bakedNode.camera));
+					std::memcpy(&cameraInfo.viewport, bakedNode.viewport,
+								sizeof(bakedNode.viewport));
+
+					CameraNode camera = scene::createCameraNode(cameraInfo);
+
+					m_cameraRecords[camera.get()] = {camera, cameraInfo.cameraInfo,
+													 cameraInfo.viewport};
+					node = camera;
+					break;
+				}
+
+				default:
+					throw std::runtime_error{"unknown node type"};
+			}
+
+			if (bakedNode.parent < 0) {
+				roots.push_back(node);
+			} else if (static_cast<size_t>(bakedNode.parent) < nodes.size()) {
+				nodes[bakedNode.parent]->add(node);
+			} else {
+				throw std::runtime_error{"corrupted file"};
+			}
+
+			nodes.push_back(node);
+		}
+
+		scene = buildScene(roots);
+	} catch (const std::exception& e) {
+		std::cerr << "Warning: not using " << path << " (" << e.what()
+				  << "), loading " << name << ".lua" << std::endl;
+	}
+
+	return scene;
+}
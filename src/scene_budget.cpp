@@ -0,0 +1,119 @@
+#include <iostream>
+#include <unordered_set>
+#include "y3.hpp"
+
+using namespace etna;
+
+void y3::setSceneBudget(size_t bytes) {
+	m_sceneBudget = bytes;
+	m_evictPending = true;
+}
+
+// the current scene counts as used until it's switched away from
+void y3::touchCurrentScene() {
+	for (const auto& [name, scene] : m_scenes) {
+		if (scene.get() == m_currScene) {
+			m_sceneUsage[name].lastUsed = m_frame;
+		}
+	}
+}
+
+// Note: the collector may run while a scene loads, so this is only an estimate
+void y3::addLuaBytes(const std::string& scene, size_t before) {
+	const size_t after = m_lua.memory_used();
+
+	if (after > before) {
+		m_sceneUsage[scene].luaBytes += after - before;
+	}
+}
+
+// assets shared with other scenes count for each of them
+size_t y3::getSceneGpuBytes(const Scene& scene) const {
+	std::unordered_set<const void*> assets;
+	size_t bytes = scene.getBufferBytes();
+
+	for (const MeshNode& node : scene.getMeshes()) {
+		for (const void* asset : {static_cast<const void*>(node->mesh.get()),
+								  static_cast<const void*>(node->material.get())}) {
+			if (asset != nullptr && assets.insert(asset).second) {
+				bytes += m_assets.getBytes(asset);
+			}
+		}
+	}
+
+	return bytes;
+}
+
+// what is actually alive, rather than the sum of the scene estimates
+size_t y3::getMemoryUsage() const {
+	size_t bytes = m_assets.getStats().bytes + m_lua.memory_used();
+
+	for (const auto& [_, scene] : m_scenes) {
+		bytes += scene->getBufferBytes();
+	}
+
+	return bytes;
+}
+
+// Sleeping scenes are destroyed, least recently used first, until the budget is
+// met. They are loaded again the next time they are switched to
+// Note 1: the current scene and main are never evicted
+// Note 2: only called between frames, the scene left by switch_scene may still be
+// running the hook that called it
+void y3::evictScenes() {
+	if (m_sceneBudget == 0) {
+		return;
+	}
+
+	while (getMemoryUsage() > m_sceneBudget) {
+		std::string oldest;
+		uint64_t oldestUse = UINT64_MAX;
+
+		for (const auto& [name, scene] : m_scenes) {
+			const uint64_t lastUsed = m_sceneUsage[name].lastUsed;
+
+			const bool sleeping = scene.get() != m_currScene && name != "main";
+
+			if (sleeping && lastUsed < oldestUse) {
+				oldest = name;
+				oldestUse = lastUsed;
+			}
+		}
+
+		if (oldest.empty()) {
+			std::cerr << "Warning: over the scene budget with nothing to evict"
+					  << std::endl;
+			return;
+		}
+
+		destroyScene(oldest);
+
+		// whatever only the scene used goes with the next full cycle
+		m_lua.collect_garbage();
+		m_assets.collect();
+
+		std::cout << "Evicted scene " << oldest << std::endl;
+	}
+}
+
+sol::table y3::getSceneMemory() {
+	sol::table scenes = m_lua.create_table();
+
+	for (const auto& [name, scene] : m_scenes) {
+		const SceneUsage& usage = m_sceneUsage[name];
+		const bool current = scene.get() == m_currScene;
+
+		scenes[name] = m_lua.create_table_with(
+			"gpu_kb", static_cast<double>(getSceneGpuBytes(*scene)) / 1024,  //
+			"lua_kb", static_cast<double>(usage.luaBytes) / 1024,			 //
+			"idle_frames", current ? 0 : m_frame - usage.lastUsed,			 //
+			"current", current);
+	}
+
+	const double usedKb = static_cast<double>(getMemoryUsage()) / 1024;
+	const double budgetKb = static_cast<double>(m_sceneBudget) / 1024;
+
+	return m_lua.create_table_with("scenes", scenes,	  //
+								   "used_kb", usedKb,	  //
+								   "budget_kb", budgetKb);
+}
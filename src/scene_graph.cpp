@@ -1,10 +1,13 @@
 #include <algorithm>
 #include "etna/engine.hpp"
+#include "gpu_memory.hpp"
 #include "scene_graph.hpp"
 #include "scene.hpp"
 
 using namespace etna;
 
+std::atomic<size_t> _SceneNode::g_liveCount[_SceneNode::TYPE_COUNT];
+
 _SceneNode::_SceneNode(Type type,
 					   const std::string& name,
 					   const Transform& transform,
@@ -13,7 +16,13 @@ _SceneNode::_SceneNode(Type type,
 	  m_type(type),
 	  m_transform(transform),
 	  m_worldMatrix(transform.getWorldMatrix()),
-	  m_scripts(scripts) {}
+	  m_scripts(scripts) {
+	g_liveCount[static_cast<size_t>(type)].fetch_add(1, std::memory_order_relaxed);
+}
+
+_SceneNode::~_SceneNode() {
+	g_liveCount[static_cast<size_t>(m_type)].fetch_sub(1, std::memory_order_relaxed);
+}
 
 SceneNode _SceneNode::add(SceneNode node) {
 	if (node == nullptr)
@@ -50,23 +59,40 @@ void _SceneNode::addScript(std::shared_ptr<Script> script) {
 	m_scripts.push_back(script);
 }
 
-void _SceneNode::applyUpdateScripts(Scene* scene) {
+void _SceneNode::applyUpdateScripts(Scene* scene, float dt, uint64_t frame) {
+	for (const auto& script : m_scripts) {
+		if (script->m_info.onUpdate == nullptr || !script->schedule(dt, frame)) {
+			continue;
+		}
+
+		if (script->m_info.parallel) {
+			scene->queueParallelUpdate({this, script.get(), script->getElapsed()});
+		} else {
+			script->runUpdate(script->getElapsed(), this, scene);
+		}
+	}
+
+	for (const auto& child : m_children) {
+		child->applyUpdateScripts(scene, dt, frame);
+	}
+}
+
+void _SceneNode::applyFixedUpdateScripts(Scene* scene, float dt) {
 	for (const auto& script : m_scripts) {
-		if (script->m_info.onUpdate != nullptr) {
-			script->m_info.onUpdate(engine::getDeltaTime(), this,
-									script->m_info.data, scene);
+		if (script->m_info.onFixedUpdate != nullptr) {
+			script->runFixedUpdate(dt, this, scene);
 		}
 	}
 
 	for (const auto& child : m_children) {
-		child->applyUpdateScripts(scene);
+		child->applyFixedUpdateScripts(scene, dt);
 	}
 }
 
 void _SceneNode::applyCreateScripts(Scene* scene) {
 	for (const auto& script : m_scripts) {
 		if (script->m_info.onStart != nullptr) {
-			script->m_info.onStart(this, script->m_info.data, scene);
+			script->runHook(Script::Hook::START, this, scene);
 		}
 	}
 
@@ -78,7 +104,7 @@ void _SceneNode::applyCreateScripts(Scene* scene) {
 void _SceneNode::applySleepScripts(Scene* scene) {
 	for (const auto& script : m_scripts) {
 		if (script->m_info.onSleep != nullptr) {
-			script->m_info.onSleep(this, script->m_info.data, scene);
+			script->runHook(Script::Hook::SLEEP, this, scene);
 		}
 	}
 
@@ -90,7 +116,7 @@ void _SceneNode::applySleepScripts(Scene* scene) {
 void _SceneNode::applyDestroyScripts(Scene* scene) {
 	for (const auto& script : m_scripts) {
 		if (script->m_info.onDestroy != nullptr) {
-			script->m_info.onDestroy(this, script->m_info.data, scene);
+			script->runHook(Script::Hook::DESTROY, this, scene);
 		}
 	}
 
@@ -175,6 +201,7 @@ CameraNode scene::createCameraNode(const CameraNodeCreateInfo& info) {
 	CameraNode node = std::make_shared<_CameraNode>(
 		_SceneNode::Type::CAMERA, info.name, info.transform, info.scripts);
 
+	gpu_memory::OwnerScope owner{gpu_memory::Owner::CAMERA};
 	node->camera = std::shared_ptr<Camera>(new Camera(info.cameraInfo));
 	node->viewport = info.viewport;
 	node->renderTarget = info.renderTarget;
@@ -187,6 +214,7 @@ LightNode scene::createLightNode(const DirectionalLight::CreateInfo& info) {
 	LightNode node = std::make_shared<_LightNode>(_SceneNode::Type::LIGHT, info.name,
 												  Transform{});
 
+	gpu_memory::OwnerScope owner{gpu_memory::Owner::LIGHT};
 	node->light = std::make_shared<DirectionalLight>(info);
 
 	return node;
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <atomic>
 #include "etna/light.hpp"
 #include "etna/transform.hpp"
 #include "etna/mesh.hpp"
@@ -20,11 +21,18 @@ struct _SceneNode {
 		LIGHT,
 	};
 
+	static constexpr size_t TYPE_COUNT = 4;
+
+	// nodes alive, by type
+	static std::atomic<size_t> g_liveCount[TYPE_COUNT];
+
 	_SceneNode(Type,
 			   const std::string&,
 			   const Transform&,
 			   const std::vector<ScriptHandle>& = {});
 
+	~_SceneNode();
+
 	SceneNode add(SceneNode);
 
 	_SceneNode* getParent() const { return m_parent; }
@@ -35,7 +43,9 @@ struct _SceneNode {
 
 	void applyCreateScripts(Scene*);
 
-	void applyUpdateScripts(Scene*);
+	void applyUpdateScripts(Scene*, float dt, uint64_t frame);
+
+	void applyFixedUpdateScripts(Scene*, float dt);
 
 	void applySleepScripts(Scene*);
 
@@ -49,6 +59,20 @@ struct _SceneNode {
 
 	Mat4 getWorldMatrix() const { return m_worldMatrix; }
 
+	// for the fixed loop, between the stored matrix (0) and the current one (1)
+	// PONDER: lerping matrices shears rotations a bit, fine over one step
+	Mat4 getWorldMatrix(float interpolation) const {
+		return m_hasPrevious
+				   ? lerp(m_previousWorldMatrix, m_worldMatrix, interpolation)
+				   : m_worldMatrix;
+	}
+
+	// the world matrix before a simulation step
+	void storeWorldMatrix() {
+		m_previousWorldMatrix = m_worldMatrix;
+		m_hasPrevious = true;
+	}
+
 	void updateTransform(const Transform&);
 
 	void updatePosition(const Vec3&);
@@ -63,6 +87,8 @@ struct _SceneNode {
 
 	const std::vector<SceneNode>& getChildren() const { return m_children; }
 
+	const std::vector<ScriptHandle>& getScripts() const { return m_scripts; }
+
 #ifndef NDEBUG
 	void print() const;
 
@@ -72,6 +98,8 @@ struct _SceneNode {
 protected:
 	Transform m_transform;
 	Mat4 m_worldMatrix;
+	Mat4 m_previousWorldMatrix;
+	bool m_hasPrevious{false};
 	std::string m_name;
 	Type m_type;
 
@@ -0,0 +1,264 @@
+#include <filesystem>
+#include <fstream>
+#include "trace.hpp"
+#include "y3.hpp"
+
+namespace fs = std::filesystem;
+using namespace etna;
+
+// instructions between two checks of the slice budget
+static constexpr int PRELOAD_HOOK_COUNT = 1000;
+
+static y3::Clock::time_point g_sliceEnd;
+
+static float secondsSince(y3::Clock::time_point start) {
+	return std::chrono::duration<float>(y3::Clock::now() - start).count();
+}
+
+// hands the frame back once the slice is over
+// Note: code called from C (require, sol callbacks...) can't yield and runs to the
+// end of the call, whatever the budget
+static void preloadHook(lua_State* L, lua_Debug*) {
+	if (y3::Clock::now() >= g_sliceEnd && lua_isyieldable(L)) {
+		lua_yield(L, 0);
+	}
+}
+
+static std::string readSource(const std::string& path) {
+	std::ifstream file{path, std::ios::binary};
+
+	return {std::istreambuf_iterator<char>{file}, std::istreambuf_iterator<char>{}};
+}
+
+std::string y3::getScenePath(const std::string& name) {
+	std::string path = fs::current_path().string() + "/" + name + ".lua";
+
+	if (!fs::exists(path)) {
+		throw std::runtime_error("Scene not found in path : " + path);
+	}
+
+	return path;
+}
+
+std::unique_ptr<Scene> y3::buildScene(sol::table nodes) {
+	std::vector<SceneNode> roots;
+
+	for (const auto& pair : nodes) {
+		sol::object obj = pair.second;
+
+		if (obj.is<SceneNode>()) {
+			roots.push_back(obj.as<SceneNode>());
+		}
+	}
+
+	return buildScene(roots);
+}
+
+std::unique_ptr<Scene> y3::buildScene(const std::vector<SceneNode>& roots) {
+	auto scene = std::make_unique<Scene>();
+
+	for (const SceneNode& node : roots) {
+		scene->addNode(node);
+	}
+
+	return scene;
+}
+
+std::unique_ptr<Scene> y3::loadScene(const std::string& name) {
+	if (m_preloads.contains(name)) {
+		// not done yet: finish it now, in a single slice
+		const bool loaded =
+			stepPreload(name, m_preloads[name], Clock::time_point::max());
+
+		// the scene file may itself have preloaded, find it again
+		auto it = m_preloads.find(name);
+		std::unique_ptr<Scene> scene = std::move(it->second.scene);
+		m_preloads.erase(it);
+
+		if (!loaded) {
+			throw std::runtime_error("Failed to load scene: " + name);
+		}
+
+		return scene;
+	}
+
+	getScenePath(name);
+
+	if (auto scene = loadBakedScene(name)) {
+		return scene;
+	}
+
+	sol::protected_function_result result;
+
+	if (auto it = m_compiledScenes.find(name); it != m_compiledScenes.end()) {
+		sol::protected_function chunk = std::move(it->second);
+		m_compiledScenes.erase(it);
+
+		result = chunk();
+	} else {
+		result = m_lua.script_file(name + ".lua");
+	}
+
+	if (!result.valid()) {
+		throw std::runtime_error("Failed to load scene: " + name);
+	}
+
+	sol::table nodes = result;
+
+	return buildScene(nodes);
+}
+
+void y3::preloadScene(const std::string& name, float budget) {
+	if (m_scenes.contains(name) || m_preloads.contains(name)) {
+		return;
+	}
+
+	const std::string path = getScenePath(name);
+
+	ScenePreload& preload = m_preloads[name];
+	preload.source = std::async(std::launch::async, readSource, path);
+	preload.budget = budget;
+	preload.status.state = PreloadStatus::State::READING;
+}
+
+// The scene file is read on a loader thread, then evaluated on the main thread in a
+// coroutine which yields every time its slice is over. Meshes and materials are
+// created as the file goes, so the GPU uploads are spread over the same frames
+bool y3::stepPreload(const std::string& name, ScenePreload& preload,
+					 Clock::time_point end) {
+	using State = PreloadStatus::State;
+
+	if (preload.status.state == State::READY) {
+		return true;
+	}
+
+	if (preload.status.state == State::READING) {
+		const bool blocking = end == Clock::time_point::max();
+
+		if (!blocking && preload.source.wait_for(std::chrono::seconds{0}) !=
+							 std::future_status::ready) {
+			return true;
+		}
+
+		sol::load_result chunk =
+			m_lua.load(preload.source.get(), "@" + name + ".lua");
+
+		if (!chunk.valid()) {
+			sol::error err = chunk;
+			std::cerr << "Error in preload of " << name << ": " << err.what()
+					  << std::endl;
+			return false;
+		}
+
+		preload.thread = sol::thread::create(m_lua.lua_state());
+		chunk.get<sol::function>().push(preload.thread.thread_state());
+
+		lua_sethook(preload.thread.thread_state(), preloadHook, LUA_MASKCOUNT,
+					PRELOAD_HOOK_COUNT);
+
+		preload.status.state = State::LOADING;
+	}
+
+	lua_State* L = preload.thread.thread_state();
+
+	// a scene file can switch to another preloaded scene
+	const auto previousEnd = g_sliceEnd;
+	const auto start = Clock::now();
+	g_sliceEnd = end;
+
+	// Note: resumed by hand, sol::coroutine pushes the function again on every
+	// resume, which breaks coroutines yielded from a hook
+	int results = 0;
+	const int status = lua_resume(L, nullptr, 0, &results);
+
+	g_sliceEnd = previousEnd;
+	preload.status.slices++;
+	preload.status.loadTime += secondsSince(start);
+
+	if (status == LUA_YIELD) {
+		lua_pop(L, results);
+		return true;
+	}
+
+	if (status != LUA_OK) {
+		// e.g. error({}), a null char* would set badbit on cerr and silence every
+		// later error
+		const char* message = lua_tostring(L, -1);
+		const std::string error = message != nullptr
+									  ? message
+									  : std::string{"(error object is a "} +
+											luaL_typename(L, -1) + " value)";
+
+		std::cerr << "Error in preload of " << name << ": " << error << std::endl;
+		return false;
+	}
+
+	if (results == 0 || !lua_istable(L, -1)) {
+		std::cerr << "Error in preload of " << name << ": no nodes returned"
+				  << std::endl;
+		return false;
+	}
+
+	// the thread goes away with the preload, reference the nodes from the main state
+	lua_State* mainL = m_lua.lua_state();
+	lua_xmove(L, mainL, 1);
+	sol::table nodes(mainL, -1);
+	lua_pop(mainL, 1);
+	lua_settop(L, 0);
+
+	preload.scene = buildScene(nodes);
+	preload.thread = sol::thread{};
+	preload.status.state = State::READY;
+
+	return true;
+}
+
+void y3::updatePreloads() {
+	// names first: scene files can preload other scenes
+	std::vector<std::string> loading;
+
+	for (const auto& [name, preload] : m_preloads) {
+		if (preload.status.state != PreloadStatus::State::READY) {
+			loading.push_back(name);
+		}
+	}
+
+	for (const std::string& name : loading) {
+		auto it = m_preloads.find(name);
+
+		if (it == m_preloads.end()) {
+			continue;
+		}
+
+		ScenePreload& preload = it->second;
+
+		const auto budget = std::chrono::duration_cast<Clock::duration>(
+			std::chrono::duration<float>{preload.budget});
+
+		const size_t luaBefore = m_lua.memory_used();
+		const auto sliceStart = Clock::now();
+		const bool loading = stepPreload(name, preload, sliceStart + budget);
+
+		trace::record(name, "preload", sliceStart, Clock::now());
+
+		addLuaBytes(name, luaBefore);
+
+		if (!loading) {
+			m_preloads.erase(name);
+		}
+	}
+}
+
+y3::PreloadStatus y3::getPreloadStatus(const std::string& name) const {
+	auto it = m_preloads.find(name);
+
+	if (it != m_preloads.end()) {
+		return it->second.status;
+	}
+
+	if (m_scenes.contains(name)) {
+		return {.state = PreloadStatus::State::READY};
+	}
+
+	return {};
+}
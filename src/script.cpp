@@ -0,0 +1,128 @@
+#include <algorithm>
+#include <cmath>
+#include "script.hpp"
+#include "trace.hpp"
+
+using namespace etna;
+
+static uint32_t g_nextId = 0;
+
+bool Script::g_profiling = false;
+
+// hooks are traced by script name, with the hook as the category
+template <typename F>
+static void profile(const Script& script,
+					Script::Hook hook,
+					Script::HookStats& stats,
+					F&& fn) {
+	const bool recording = trace::isRecording();
+
+	if (!Script::g_profiling && !recording) {
+		fn();
+		return;
+	}
+
+	const auto start = std::chrono::steady_clock::now();
+
+	fn();
+
+	const auto end = std::chrono::steady_clock::now();
+	const std::chrono::duration<float> time = end - start;
+
+	if (recording) {
+		trace::record(script.m_info.name, Script::getHookName(hook), start, end);
+	}
+
+	if (Script::g_profiling) {
+		stats.calls++;
+		stats.total += time.count();
+		stats.max = std::max(stats.max, time.count());
+	}
+}
+
+const char* Script::getHookName(Hook hook) {
+	static constexpr const char* NAMES[] = {
+		"update", "fixed_update", "start", "sleep", "destroy",
+	};
+
+	return NAMES[static_cast<size_t>(hook)];
+}
+
+// spread rate limited scripts over frames, so that they don't all fire together
+Script::Script(const CreateInfo& info)
+	: m_info(info), m_id(g_nextId++), m_phase(m_id) {
+	if (m_info.rate > 0) {
+		const float offset = std::fmod(m_phase * 0.618034f, 1.f);
+		m_accumulator = offset / m_info.rate;
+	}
+}
+
+void Script::runUpdate(float dt, _SceneNode* node, Scene* const scene) {
+	profile(*this, Hook::UPDATE, m_hookStats[static_cast<size_t>(Hook::UPDATE)],
+			[&] { m_info.onUpdate(dt, node, m_info.data, scene); });
+}
+
+void Script::runFixedUpdate(float dt, _SceneNode* node, Scene* const scene) {
+	profile(*this, Hook::FIXED_UPDATE,
+			m_hookStats[static_cast<size_t>(Hook::FIXED_UPDATE)],
+			[&] { m_info.onFixedUpdate(dt, node, m_info.data, scene); });
+}
+
+void Script::runHook(Hook hook, _SceneNode* node, Scene* const scene) {
+	const HookFunc& fn = hook == Hook::START ? m_info.onStart
+						 : hook == Hook::SLEEP ? m_info.onSleep
+											   : m_info.onDestroy;
+
+	profile(*this, hook, m_hookStats[static_cast<size_t>(hook)],
+			[&] { fn(node, m_info.data, scene); });
+}
+
+float Script::getTotalTime() const {
+	float total = 0;
+
+	for (const HookStats& stats : m_hookStats) {
+		total += stats.total;
+	}
+
+	return total;
+}
+
+void Script::reload(const CreateInfo& info) {
+	sol::table data = m_info.data;
+
+	m_info = info;
+	m_info.data = data;
+	m_revision++;
+}
+
+bool Script::schedule(float dt, uint64_t frame) {
+	// the same script can be shared by many nodes
+	if (frame == m_lastFrame) {
+		return m_due;
+	}
+
+	m_lastFrame = frame;
+	m_sinceUpdate += dt;
+
+	if (m_info.every > 1) {
+		m_due = (frame + m_phase) % m_info.every == 0;
+	} else if (m_info.rate > 0) {
+		const float period = 1 / m_info.rate;
+
+		m_accumulator += dt;
+		m_due = m_accumulator >= period;
+
+		if (m_due) {
+			m_accumulator = std::fmod(m_accumulator, period);
+		}
+	} else {
+		m_due = true;
+	}
+
+	if (m_due) {
+		m_elapsed = m_sinceUpdate;
+		m_sinceUpdate = 0;
+	}
+
+	return m_due;
+}
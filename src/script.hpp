@@ -1,5 +1,7 @@
 #pragma once
 
+#include <array>
+#include <chrono>
 #include <functional>
 #include <string>
 #include "sol.hpp"
@@ -18,15 +20,82 @@ struct Script {
 	struct CreateInfo {
 		std::string name;
 		UpdateFunc onUpdate;
+		UpdateFunc onFixedUpdate;
 		HookFunc onStart;
 		HookFunc onSleep;
 		HookFunc onDestroy;
 		sol::table data;
+		float rate{0};
+		uint32_t every{0};
+		bool parallel{false};
+		std::string parallelCode;
+		// chunk the hooks were defined in
+		std::string source;
 	};
 
-	Script(const CreateInfo& info) : m_info(info) {}
+	enum class Hook : uint8_t {
+		UPDATE,
+		FIXED_UPDATE,
+		START,
+		SLEEP,
+		DESTROY,
+		COUNT,
+	};
+
+	// times in seconds
+	struct HookStats {
+		uint32_t calls{0};
+		float total{0};
+		float max{0};
+	};
+
+	// Note: off by default, then a hook only costs a branch more
+	static bool g_profiling;
+
+	static const char* getHookName(Hook);
+
+	Script(const CreateInfo& info);
+
+	// call the hooks with the script data, timing them when profiling
+	void runUpdate(float dt, _SceneNode*, Scene* const);
+
+	void runFixedUpdate(float dt, _SceneNode*, Scene* const);
+
+	void runHook(Hook, _SceneNode*, Scene* const);
+
+	const HookStats& getHookStats(Hook hook) const {
+		return m_hookStats[static_cast<size_t>(hook)];
+	}
+
+	float getTotalTime() const;
+
+	// Note: rate limited scripts are due only in some frames, and then they get
+	// the time elapsed since their previous update instead of the frame delta
+	bool schedule(float dt, uint64_t frame);
+
+	float getElapsed() const { return m_elapsed; }
+
+	uint32_t getId() const { return m_id; }
+
+	// swaps the hooks and settings for those of a newer version of the script,
+	// keeping the data and the schedule
+	void reload(const CreateInfo&);
+
+	// bumped by every reload
+	uint32_t getRevision() const { return m_revision; }
 
 	CreateInfo m_info;
+
+private:
+	uint32_t m_id{0};
+	uint32_t m_phase{0};
+	uint32_t m_revision{0};
+	uint64_t m_lastFrame{UINT64_MAX};
+	bool m_due{true};
+	float m_accumulator{0};
+	float m_sinceUpdate{0};
+	float m_elapsed{0};
+	std::array<HookStats, static_cast<size_t>(Hook::COUNT)> m_hookStats{};
 };
 
 using ScriptHandle = std::shared_ptr<Script>;
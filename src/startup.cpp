@@ -0,0 +1,46 @@
+#include <filesystem>
+#include "trace.hpp"
+#include "y3.hpp"
+
+using namespace etna;
+
+static float secondsSince(y3::Clock::time_point start) {
+	return std::chrono::duration<float>(y3::Clock::now() - start).count();
+}
+
+// runs on its own thread, while the main thread creates the device, window and
+// renderer
+void y3::setupLua(const std::string& firstScene) {
+	const auto start = Clock::now();
+
+	trace::setThreadName("lua setup");
+
+	m_lua.open_libraries(sol::lib::base, sol::lib::math, sol::lib::package,
+						 sol::lib::io);
+
+	y3_table = m_lua.create_named_table("y3");
+
+	initLuaBindings();
+
+	initLuaTypes(m_lua);
+
+	setGcSettings(m_gcSettings);
+
+	m_startupStats.luaTime = secondsSince(start);
+	trace::record("lua_setup", "startup", start, Clock::now());
+
+	const auto readStart = Clock::now();
+	const std::string path = firstScene + ".lua";
+
+	// named like script_file names it, a syntax error is reported by the load
+	if (std::filesystem::exists(path)) {
+		sol::load_result chunk = m_lua.load_file(path);
+
+		if (chunk.valid()) {
+			m_compiledScenes[firstScene] = chunk.get<sol::protected_function>();
+		}
+	}
+
+	m_startupStats.sceneReadTime = secondsSince(readStart);
+	trace::record(path, "startup", readStart, Clock::now());
+}
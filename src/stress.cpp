@@ -0,0 +1,175 @@
+#include "stress.hpp"
+
+using namespace etna;
+
+// generate({
+//   name = "stress",    -- prefix of the node names
+//   depth = 3,          -- levels under the root, 1 for a wide flat root
+//   fanout = 4,         -- children of every node
+//   scripted = 0,       -- fraction of the meshes with an update script
+//   script = nil,       -- the script they get, a spinning one by default
+//   materials = 1,      -- unique color materials, 0 for none (headless)
+//   lights = 0,         -- directional lights under the root
+//   mesh = nil,         -- mesh of every node, y3.get_cube() if there is one
+//   spacing = 1.5,      -- distance between the leaves
+//   max_nodes = 1e6,    -- safety net against typos in depth and fanout
+// })
+// returns the root and the counts of what was made
+static constexpr const char* SOURCE = R"lua(
+local y3 = ...
+
+-- by name, the colors are only defined after this module is loaded
+local PALETTE = { "RED", "GREEN", "BLUE", "PURPLE", "CELESTE", "YELLOW", "WHITE" }
+
+local function count_nodes(depth, fanout)
+  local count, level = 0, 1
+  for _ = 1, depth do
+    level = level * fanout
+    count = count + level
+  end
+  return count
+end
+
+local spin
+
+local function get_spin_script()
+  spin = spin or y3.create_script({
+    name = "stress_spin",
+    update = function(dt, node) node:rotate(dt, 0, 0) end,
+  })
+  return spin
+end
+
+-- every color is different, the color materials are cached by color
+local function create_materials(count)
+  local colors = {}
+
+  for _, color in ipairs(PALETTE) do
+    colors[#colors + 1] = _G[color]
+  end
+
+  if count > 0 and #colors == 0 then
+    error("stress: no colors defined for the materials")
+  end
+
+  local materials = {}
+  local shades = math.ceil(count / math.max(#colors, 1))
+
+  for i = 0, count - 1 do
+    local color = colors[i % #colors + 1]
+    local shade = i // #colors
+    materials[i + 1] = y3.create_color_material(color * (1 - shade / (shades + 1)))
+  end
+
+  return materials
+end
+
+local M = {}
+
+function M.count(params)
+  return count_nodes(params.depth or 3, params.fanout or 4)
+end
+
+function M.generate(params)
+  params = params or {}
+
+  local name = params.name or "stress"
+  local depth = params.depth or 3
+  local fanout = params.fanout or 4
+  local scripted = params.scripted or 0
+  local spacing = params.spacing or 1.5
+  local max_nodes = params.max_nodes or 1e6
+
+  if depth < 1 or fanout < 1 then
+    error("stress: depth and fanout must be at least 1")
+  end
+
+  local total = count_nodes(depth, fanout)
+
+  if total > max_nodes then
+    error(("stress: %d nodes over max_nodes %d"):format(total, max_nodes))
+  end
+
+  local mesh = params.mesh
+  if mesh == nil and y3.get_cube then
+    mesh = y3.get_cube()
+  end
+
+  local script = nil
+  if scripted > 0 then
+    script = params.script or get_spin_script()
+  end
+
+  local materials = create_materials(params.materials or 1)
+
+  -- children are laid out on a square grid, wide enough for their subtrees
+  local columns = math.ceil(math.sqrt(fanout))
+  local stats = { nodes = 0, meshes = 0, scripted = 0, lights = 0,
+                  materials = #materials }
+
+  -- scripts go to every n-th mesh, spread evenly through the graph
+  local debt = 0
+
+  local function build(parent, level, width)
+    for i = 0, fanout - 1 do
+      local x = (i % columns - (columns - 1) / 2) * width
+      local z = (i // columns - (columns - 1) / 2) * width
+
+      stats.meshes = stats.meshes + 1
+      debt = debt + scripted
+
+      local scripts = nil
+      if debt >= 1 then
+        debt = debt - 1
+        scripts = script
+        stats.scripted = stats.scripted + 1
+      end
+
+      local node = parent:add(y3.create_mesh({
+        name = name .. "_" .. stats.meshes,
+        mesh = mesh,
+        material = #materials > 0
+          and materials[(stats.meshes - 1) % #materials + 1] or nil,
+        position = Vec3.new(x, -spacing, z),
+        scripts = scripts,
+      }))
+
+      if level < depth then
+        build(node, level + 1, width / columns)
+      end
+    end
+  end
+
+  local root = y3.create_root(name)
+  build(root, 1, spacing * columns ^ (depth - 1))
+
+  for i = 1, params.lights or 0 do
+    local angle = 2 * math.pi * i / params.lights
+    root:add(y3.create_light({
+      name = name .. "_light_" .. i,
+      direction = Vec3.new(math.cos(angle), -1, math.sin(angle)),
+      intensity = 1 / params.lights,
+    }))
+    stats.lights = stats.lights + 1
+  end
+
+  stats.nodes = 1 + stats.meshes + stats.lights
+
+  return root, stats
+end
+
+return M
+)lua";
+
+sol::table stress::load(sol::state_view lua, sol::table y3) {
+	sol::protected_function chunk = lua.load(SOURCE, "=y3.stress");
+	sol::protected_function_result result = chunk(y3);
+
+	if (!result.valid()) {
+		sol::error err = result;
+		throw std::runtime_error{"Failed to load y3.stress: " +
+								 std::string{err.what()}};
+	}
+
+	return result;
+}
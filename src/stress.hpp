@@ -0,0 +1,14 @@
+#pragma once
+
+#include "sol.hpp"
+
+// Synthetic scenes for load tests, from lua: y3.stress.generate({...})
+// Note: the module only builds on the y3 functions it is given (create_root,
+// create_mesh, create_script and, when there are materials or lights,
+// create_color_material and create_light), so headless programs can pass a
+// table with just the scene graph functions
+namespace etna::stress {
+
+sol::table load(sol::state_view lua, sol::table y3);
+
+}  // namespace etna::stress
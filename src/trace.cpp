@@ -0,0 +1,177 @@
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "trace.hpp"
+
+using namespace etna;
+using trace::Clock;
+
+namespace {
+
+struct Event {
+	uint32_t nameOffset;
+	uint32_t nameSize;
+	const char* category;
+	Clock::time_point start;
+	Clock::duration duration;
+};
+
+struct ThreadBuffer {
+	uint32_t id{0};
+	std::string threadName;
+	std::string names;
+	std::vector<Event> events;
+	size_t dropped{0};
+};
+
+// buffers outlive their threads, events of short lived threads are kept
+std::mutex g_mutex;
+std::vector<std::unique_ptr<ThreadBuffer>> g_buffers;
+Clock::time_point g_start;
+
+thread_local ThreadBuffer* t_buffer = nullptr;
+
+// per thread, 128 MB of events without their names
+constexpr size_t MAX_EVENTS = size_t{1} << 22;
+
+}  // namespace
+
+std::atomic<bool> trace::g_recording{false};
+
+static ThreadBuffer& getBuffer() {
+	if (t_buffer == nullptr) {
+		std::lock_guard lock{g_mutex};
+
+		auto buffer = std::make_unique<ThreadBuffer>();
+		buffer->id = static_cast<uint32_t>(g_buffers.size() + 1);
+
+		t_buffer = buffer.get();
+		g_buffers.push_back(std::move(buffer));
+	}
+
+	return *t_buffer;
+}
+
+void trace::start() {
+	std::lock_guard lock{g_mutex};
+
+	for (auto& buffer : g_buffers) {
+		buffer->names.clear();
+		buffer->events.clear();
+		buffer->dropped = 0;
+	}
+
+	g_start = Clock::now();
+	g_recording.store(true, std::memory_order_release);
+}
+
+void trace::record(std::string_view name,
+				   const char* category,
+				   Clock::time_point start,
+				   Clock::time_point end) {
+	if (!isRecording()) {
+		return;
+	}
+
+	ThreadBuffer& buffer = getBuffer();
+
+	if (buffer.events.size() >= MAX_EVENTS) {
+		buffer.dropped++;
+		return;
+	}
+
+	buffer.events.push_back({
+		.nameOffset = static_cast<uint32_t>(buffer.names.size()),
+		.nameSize = static_cast<uint32_t>(name.size()),
+		.category = category,
+		.start = start,
+		.duration = end - start,
+	});
+
+	buffer.names.append(name);
+}
+
+void trace::setThreadName(std::string_view name) {
+	getBuffer().threadName = name;
+}
+
+static void writeString(std::ostream& out, std::string_view string) {
+	out << '"';
+
+	for (char c : string) {
+		if (c == '"' || c == '\\') {
+			out << '\\' << c;
+		} else if (static_cast<unsigned char>(c) < 0x20) {
+			out << ' ';
+		} else {
+			out << c;
+		}
+	}
+
+	out << '"';
+}
+
+static double toMicroseconds(Clock::duration duration) {
+	return std::chrono::duration<double, std::micro>(duration).count();
+}
+
+size_t trace::stop(const std::string& path) {
+	g_recording.store(false, std::memory_order_release);
+
+	std::lock_guard lock{g_mutex};
+
+	std::ofstream out{path};
+
+	if (!out) {
+		std::cerr << "Error in trace: can't write " << path << std::endl;
+		return 0;
+	}
+
+	out << std::fixed << std::setprecision(3);
+	out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+
+	size_t count = 0;
+	bool first = true;
+
+	for (const auto& buffer : g_buffers) {
+		if (buffer->events.empty()) {
+			continue;
+		}
+
+		if (!buffer->threadName.empty()) {
+			out << (first ? "" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\","
+				<< "\"pid\":1,\"tid\":" << buffer->id << ",\"args\":{\"name\":";
+			writeString(out, buffer->threadName);
+			out << "}}";
+			first = false;
+		}
+
+		for (const Event& event : buffer->events) {
+			out << (first ? "" : ",\n") << "{\"name\":";
+			writeString(out, std::string_view{buffer->names}.substr(
+								 event.nameOffset, event.nameSize));
+			out << ",\"cat\":\"" << event.category << "\",\"ph\":\"X\",\"pid\":1"
+				<< ",\"tid\":" << buffer->id
+				<< ",\"ts\":" << toMicroseconds(event.start - g_start)
+				<< ",\"dur\":" << toMicroseconds(event.duration) << '}';
+			first = false;
+		}
+
+		count += buffer->events.size();
+
+		if (buffer->dropped > 0) {
+			std::cerr << "Warning: trace buffer of " << buffer->threadName
+					  << " full, " << buffer->dropped << " events dropped"
+					  << std::endl;
+		}
+	}
+
+	out << "\n]}\n";
+
+	std::cout << "Trace: " << count << " events written to " << path << std::endl;
+
+	return count;
+}
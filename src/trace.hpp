@@ -0,0 +1,67 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <string_view>
+
+// Timeline of events in the Chrome trace format, for chrome://tracing or Perfetto
+// Note 1: every thread records into its own buffer, without locks. A thread only
+// takes a lock the first time it records
+// Note 2: start and stop must not race with other threads recording, y3 calls them
+// between frames, when the workers are idle
+namespace etna::trace {
+
+using Clock = std::chrono::steady_clock;
+
+extern std::atomic<bool> g_recording;
+
+inline bool isRecording() {
+	return g_recording.load(std::memory_order_acquire);
+}
+
+void start();
+
+// writes the events recorded since start, returns their count
+size_t stop(const std::string& path);
+
+// names are copied, they don't have to outlive the event
+void record(std::string_view name,
+			const char* category,
+			Clock::time_point start,
+			Clock::time_point end);
+
+// names the calling thread in the trace
+void setThreadName(std::string_view name);
+
+// records its lifetime, if the trace was recording when it was made
+// Note: the name is only copied at the end, it must outlive the scope
+class Scope {
+public:
+	Scope(std::string_view name, const char* category) {
+		if (isRecording()) {
+			m_name = name;
+			m_category = category;
+			m_start = Clock::now();
+		}
+	}
+
+	~Scope() {
+		if (m_category != nullptr) {
+			record(m_name, m_category, m_start, Clock::now());
+		}
+	}
+
+private:
+	std::string_view m_name;
+	const char* m_category{nullptr};
+	Clock::time_point m_start;
+
+public:
+	Scope(const Scope&) = delete;
+	Scope& operator=(const Scope&) = delete;
+	Scope(Scope&&) = delete;
+	Scope& operator=(Scope&&) = delete;
+};
+
+}  // namespace etna::trace
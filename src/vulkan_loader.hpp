@@ -0,0 +1,23 @@
+#pragma once
+
+#include <dlfcn.h>
+#include <cstdlib>
+#include <iostream>
+
+namespace etna {
+
+// the loader definition of a vulkan function y3 interposes: libetna
+// is linked statically, so y3's definition shadows the loader's for it
+template <typename F>
+F getLoaderFunction(const char* name) {
+	auto fn = reinterpret_cast<F>(dlsym(RTLD_NEXT, name));
+
+	if (fn == nullptr) {
+		std::cerr << "Error in vulkan interposition: " << name << " not found\n";
+		std::abort();
+	}
+
+	return fn;
+}
+
+}  // namespace etna
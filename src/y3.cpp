@@ -1,14 +1,52 @@
-#include <filesystem>
+#include <algorithm>
+#include <iostream>
+#include <thread>
+#include "pipeline_cache.hpp"
+#include "trace.hpp"
 #include "y3.hpp"
 
-namespace fs = std::filesystem;
 using namespace etna;
 
 Window* y3::g_window = nullptr;
+bool y3::g_pipelineStats = false;
+
+static float secondsSince(y3::Clock::time_point start) {
+	return std::chrono::duration<float>(y3::Clock::now() - start).count();
+}
+
+// cold runs compile every pipeline, warm runs mostly hit the cache on disk
+static void printPipelineTimes(const char* label,
+							   y3::Clock::time_point start,
+							   const pipeline_cache::Stats& before) {
+	if (!y3::g_pipelineStats) {
+		return;
+	}
+
+	const pipeline_cache::Stats stats = pipeline_cache::getStats();
+	const std::chrono::duration<float, std::milli> time = y3::Clock::now() - start;
+
+	std::cout << label << ": " << time.count() << " ms, "
+			  << stats.pipelines - before.pipelines << " pipelines in "
+			  << (stats.createTime - before.createTime) * 1000 << " ms ("
+			  << (stats.warm ? "warm" : "cold") << " pipeline cache)" << std::endl;
+}
+
+y3::y3(uint32_t width, uint32_t height, const std::string& firstScene) {
+	const auto start = Clock::now();
+
+	trace::setThreadName("main");
+
+	// nothing on the Lua side touches the device, so it's set up meanwhile
+	std::future<void> luaSetup = std::async(
+		std::launch::async, [this, &firstScene] { setupLua(firstScene); });
 
-y3::y3(uint32_t width, uint32_t height) {
 	engine::init();
 
+	m_startupStats.engineTime = secondsSince(start);
+	trace::record("engine_init", "startup", start, Clock::now());
+
+	auto stepStart = Clock::now();
+
 	g_window = new Window({
 		.width = width,
 		.height = height,
@@ -16,105 +54,359 @@ y3::y3(uint32_t width, uint32_t height) {
 		.captureMouse = true,
 	});
 
+	m_startupStats.windowTime = secondsSince(stepStart);
+	trace::record("window", "startup", stepStart, Clock::now());
+	stepStart = Clock::now();
+
 	m_renderer = new Renderer({});
 
-	m_lua.open_libraries(sol::lib::base, sol::lib::math, sol::lib::package,
-						 sol::lib::io);
+	m_startupStats.rendererTime = secondsSince(stepStart);
+	trace::record("renderer", "startup", stepStart, Clock::now());
+	stepStart = Clock::now();
 
-	y3_table = m_lua.create_named_table("y3");
+	luaSetup.get();
 
-	initLuaBindings();
+	m_startupStats.waitTime = secondsSince(stepStart);
+	trace::record("lua_wait", "startup", stepStart, Clock::now());
+	m_startupStats.totalTime = secondsSince(start);
 
-	initLuaTypes();
+	printPipelineTimes("Startup", start, {});
 }
 
 y3::~y3() {
+	// Note: etna doesn't destroy its device when the app exits
+	pipeline_cache::save();
+
 	delete g_window;
 	delete m_renderer;
 	m_currScene = nullptr;
 
 	for (auto& [_, script] : m_globalScripts) {
 		if (script->m_info.onDestroy != nullptr) {
-			script->m_info.onDestroy(nullptr, script->m_info.data, nullptr);
+			script->runHook(Script::Hook::DESTROY, nullptr, nullptr);
 		}
 	}
 
+	if (Script::g_profiling) {
+		printScriptStats(20);
+	}
+
 	m_lua.collect_garbage();
 }
 
 void y3::run() {
+	using Phase = FrameProfiler::Phase;
+
 	while (!g_window->shouldClose()) {
+		const auto frameStart = Clock::now();
+
+		m_profiler.beginFrame();
+
+		// headless frames record no GPU work to time
+		if (!m_headless) {
+			const uint64_t frame = m_profiler.getFrameNumber();
+
+			if (const auto gpu = m_gpuProfiler.beginFrame(frame)) {
+				m_profiler.setGpuTime(gpu->frame, gpu->time);
+			}
+		}
+
 		engine::updateTime();
 
+		float dt = engine::getDeltaTime();
+
+		m_profiler.endPhase(Phase::TIME);
+
 		g_window->pollEvents();
 
-		m_currScene->applyUpdateScripts();
+		m_profiler.endPhase(Phase::EVENTS);
 
-		for (auto& [_, script] : m_globalScripts) {
-			if (script->m_info.onUpdate != nullptr) {
-				script->m_info.onUpdate(engine::getDeltaTime(), nullptr,
-										script->m_info.data, m_currScene);
-			}
+		updateHotReload();
+
+		m_profiler.endPhase(Phase::HOT_RELOAD);
+
+		if (!updateInput(dt)) {
+			finishReplay();
+			break;
 		}
 
-		m_currScene->render(*m_renderer);
+		m_profiler.endPhase(Phase::INPUT);
+
+		float interpolation = 1;
 
-		g_window->swapBuffers();
+		const bool fixed = m_loopSettings.mode == LoopSettings::Mode::FIXED;
+
+		if (fixed && m_fixedTimestep > 0) {
+			interpolation = runFixedSteps(dt);
+		} else {
+			runStep(dt);
+		}
+
+		updatePreloads();
+
+		m_profiler.endPhase(Phase::PRELOAD);
+
+		if (!m_headless) {
+			m_currScene->render(*m_renderer, {.gpuProfiler = &m_gpuProfiler,
+											  .interpolation = interpolation});
+		}
+
+		m_profiler.endPhase(Phase::RENDER);
+
+		// no script is running here, so no scene is on the stack
+		if (m_evictPending) {
+			m_evictPending = false;
+			evictScenes();
+		}
+
+		stepGarbageCollector(frameStart);
+
+		m_profiler.endPhase(Phase::GC);
+
+		if (!m_headless) {
+			g_window->swapBuffers();
+		}
+
+		m_profiler.endPhase(Phase::SWAP);
+
+		limitFrameRate();
+
+		m_profiler.endPhase(Phase::LIMIT);
+		m_profiler.endFrame();
+		m_luaAllocator.endFrame();
+
+		updateStatsLog();
+
+		if (m_inputRecording.getMode() == InputRecording::Mode::REPLAY) {
+			m_replayTimes.push_back(m_profiler.getLastFrameTime());
+		}
+
+		m_frame++;
 	}
 }
 
-void y3::switchScene(const std::string& sceneName) {
-	auto it = m_scenes.find(sceneName);
+void y3::runStep(float dt) {
+	using Phase = FrameProfiler::Phase;
 
-	if (it != m_scenes.end()) {
-		m_currScene->applySleepScripts();
-		m_currScene = it->second.get();
+	m_input.dispatch();
+
+	m_profiler.endPhase(Phase::INPUT);
+
+	m_coroutines.advance(dt);
+
+	applyFixedUpdateScripts(dt);
+
+	m_profiler.endPhase(Phase::FIXED_UPDATE);
+
+	// an update can switch scenes, the new one already ran its parallel updates
+	Scene* scene = m_currScene;
+	scene->applyUpdateScripts(dt, m_step);
+
+	m_profiler.endPhase(Phase::UPDATE);
+
+	m_parallelScripts.run(scene->getParallelQueue());
+
+	m_profiler.endPhase(Phase::PARALLEL);
+
+	applyGlobalScripts(dt);
+
+	m_profiler.endPhase(Phase::GLOBAL_SCRIPTS);
+
+	m_coroutines.update();
+
+	m_profiler.endPhase(Phase::COROUTINES);
+
+	m_input.consume();
+	m_step++;
+}
+
+// Note 1: a step runs the fixed updates too, they match the steps one to one
+// Note 2: the render lags the simulation by up to a step, in exchange it moves
+// smoothly whatever the frame rate
+// Note 3: input edges wait for the next step, and only that step sees them
+float y3::runFixedSteps(float dt) {
+	const float step = m_fixedTimestep;
+
+	m_stepAccumulator = std::min(m_stepAccumulator + dt, step * MAX_FIXED_STEPS);
+
+	while (m_stepAccumulator >= step) {
+		m_currScene->storeWorldMatrices();
+		m_interpolatedScene = m_currScene;
+
+		runStep(step);
+
+		m_stepAccumulator -= step;
+	}
+
+	// a scene that hasn't stepped yet has no matrices stored, or stale ones
+	if (!m_loopSettings.interpolate || m_interpolatedScene != m_currScene) {
+		return 1;
+	}
+
+	return m_stepAccumulator / step;
+}
+
+// sleeps short of when the next frame is due and spins the rest, sleeps wake
+// up late by up to a scheduler tick
+void y3::limitFrameRate() {
+	using Seconds = std::chrono::duration<float>;
+
+	if (m_loopSettings.maxFps <= 0) {
 		return;
 	}
 
-	std::string path = fs::current_path().string() + "/" + sceneName + ".lua";
+	const auto now = Clock::now();
 
-	if (!fs::exists(path)) {
-		throw std::runtime_error("Scene not found in path : " + path);
+	m_nextFrame += std::chrono::duration_cast<Clock::duration>(
+		Seconds(1 / m_loopSettings.maxFps));
+
+	// behind, e.g. after a long frame: start over rather than catch up
+	if (m_nextFrame <= now) {
+		m_nextFrame = now;
+		return;
 	}
 
-	sol::protected_function_result result = m_lua.script_file(sceneName + ".lua");
+	const auto spinStart =
+		m_nextFrame - std::chrono::duration_cast<Clock::duration>(
+						  Seconds(m_loopSettings.spinTime));
+
+	if (now < spinStart) {
+		std::this_thread::sleep_until(spinStart);
+	}
 
-	if (!result.valid()) {
-		throw std::runtime_error("Failed to load scene: " + sceneName);
+	while (Clock::now() < m_nextFrame) {
 	}
+}
+
+void y3::setLoopSettings(const LoopSettings& settings) {
+	m_loopSettings = settings;
+	m_stepAccumulator = 0;
+	m_interpolatedScene = nullptr;
+	m_nextFrame = {};
 
-	auto scene = std::make_unique<Scene>();
+	// puts the cameras back where the steps left them
+	if (m_currScene != nullptr) {
+		m_currScene->storeWorldMatrices();
+	}
+}
 
-	sol::table sceneTable = result;
+void y3::applyFixedUpdateScripts(float dt) {
+	if (m_fixedTimestep <= 0) {
+		return;
+	}
 
-	for (const auto& pair : sceneTable) {
-		SceneNode node = pair.second.as<SceneNode>();
+	// don't spiral when a frame takes longer than many steps
+	m_fixedAccumulator =
+		std::min(m_fixedAccumulator + dt, m_fixedTimestep * MAX_FIXED_STEPS);
 
-		sol::object obj = pair.second;
+	while (m_fixedAccumulator >= m_fixedTimestep) {
+		m_currScene->applyFixedUpdateScripts(m_fixedTimestep);
 
-		if (obj.is<SceneNode>()) {
-			SceneNode node = obj.as<SceneNode>();
-			scene->addNode(node);
+		for (auto& [_, script] : m_globalScripts) {
+			if (script->m_info.onFixedUpdate != nullptr) {
+				script->runFixedUpdate(m_fixedTimestep, nullptr, m_currScene);
+			}
 		}
+
+		m_fixedAccumulator -= m_fixedTimestep;
 	}
+}
+
+void y3::applyGlobalScripts(float dt) {
+	for (auto& [_, script] : m_globalScripts) {
+		if (script->m_info.onUpdate != nullptr && script->schedule(dt, m_step)) {
+			script->runUpdate(script->getElapsed(), nullptr, m_currScene);
+		}
+	}
+}
+
+// built at most once per frame, for scripts which prefer to poll
+sol::table y3::getInputTable() {
+	if (m_inputTableStep == m_step) {
+		return m_inputTable;
+	}
+
+	const InputSnapshot& snapshot = m_input.getSnapshot();
+
+	sol::table down = m_lua.create_table();
+	sol::table pressed = m_lua.create_table();
+	sol::table released = m_lua.create_table();
+
+	for (int key = KEY_SPACE; key <= KEY_MENU; key++) {
+		if (snapshot.down[key])
+			down[key] = true;
+
+		if (snapshot.pressed[key])
+			pressed[key] = true;
+
+		if (snapshot.released[key])
+			released[key] = true;
+	}
+
+	m_inputTable = m_lua.create_table_with(
+		"down", down,					  //
+		"pressed", pressed,				  //
+		"released", released,			  //
+		"mouse_x", snapshot.mouseX,		  //
+		"mouse_y", snapshot.mouseY,		  //
+		"mouse_dx", snapshot.mouseDeltaX,  //
+		"mouse_dy", snapshot.mouseDeltaY);
+
+	m_inputTableStep = m_step;
+
+	return m_inputTable;
+}
+
+void y3::switchScene(const std::string& sceneName) {
+	touchCurrentScene();
+	m_interpolatedScene = nullptr;
+
+	auto it = m_scenes.find(sceneName);
+
+	if (it != m_scenes.end()) {
+		m_currScene->applySleepScripts();
+		m_currScene = it->second.get();
+		m_sceneUsage[sceneName].lastUsed = m_frame;
+		return;
+	}
+
+	const auto start = Clock::now();
+	const pipeline_cache::Stats before = pipeline_cache::getStats();
+	const size_t luaBefore = m_lua.memory_used();
+
+	std::unique_ptr<Scene> scene = loadScene(sceneName);
+
+	addLuaBytes(sceneName, luaBefore);
+	trace::record(sceneName, "scene_load", start, Clock::now());
+
+	printPipelineTimes(("Scene " + sceneName).c_str(), start, before);
 
 	if (m_currScene != nullptr) {
 		m_currScene->applySleepScripts();
 	}
 
 	scene->applyStartScripts();
-	scene->applyUpdateScripts();
+	scene->applyUpdateScripts(m_dt, m_step);
+	m_parallelScripts.run(scene->getParallelQueue());
 
 	m_currScene = scene.get();
 	m_scenes[sceneName] = std::move(scene);
+	m_sceneUsage[sceneName].lastUsed = m_frame;
+
+	m_evictPending = true;
 }
 
 void y3::destroyScene(const std::string& sceneName) {
 	auto it = m_scenes.find(sceneName);
 
 	if (it != m_scenes.end() && it->first != "main") {
+		m_sceneUsage.erase(it->first);
 		m_scenes.erase(it);
+		m_assets.collect();
+
+		std::erase_if(m_cameraRecords, [](const auto& pair) {
+			return pair.second.node.expired();
+		});
 	}
 }
 
@@ -122,7 +414,7 @@ void y3::addGlobalScript(ScriptHandle script) {
 	m_globalScripts[script->m_info.name] = script;
 
 	if (script->m_info.onStart != nullptr) {
-		script->m_info.onStart(nullptr, script->m_info.data, nullptr);
+		script->runHook(Script::Hook::START, nullptr, nullptr);
 	}
 }
 
@@ -130,7 +422,7 @@ void y3::removeGlobalScript(const std::string& name) {
 	auto it = m_globalScripts.find(name);
 
 	if (it != m_globalScripts.end()) {
-		it->second->m_info.onDestroy(nullptr, it->second->m_info.data, nullptr);
+		it->second->runHook(Script::Hook::DESTROY, nullptr, nullptr);
 		m_globalScripts.erase(it);
 	}
 }
@@ -1,12 +1,85 @@
 #pragma once
 
+#include <chrono>
+#include <future>
 #include "sol.hpp"
 #include "scene.hpp"
+#include "coroutines.hpp"
+#include "input.hpp"
+#include "input_recording.hpp"
+#include "lua_allocator.hpp"
+#include "asset_cache.hpp"
+#include "file_watcher.hpp"
+#include "frame_profiler.hpp"
 #include "etna/etna_core.hpp"
 
 class y3 {
 public:
-	y3(uint32_t width, uint32_t height);
+	using Clock = std::chrono::steady_clock;
+
+	static constexpr uint32_t MAX_FIXED_STEPS = 5;
+
+	struct PreloadStatus {
+		enum class State {
+			NONE,
+			READING,
+			LOADING,
+			READY,
+		};
+
+		State state{State::NONE};
+		uint32_t slices{0};
+		float loadTime{0};
+	};
+
+	struct GcSettings {
+		enum class Mode {
+			AUTO,
+			INCREMENTAL,
+			GENERATIONAL,
+		};
+
+		Mode mode{Mode::INCREMENTAL};
+		float targetFrameTime{1.f / 60};
+		float minStepTime{0.0002f};
+		float maxStepTime{0.002f};
+		int stepSize{0};
+		int pause{200};
+		int minorMultiplier{20};
+	};
+
+	struct LoopSettings {
+		enum class Mode {
+			VARIABLE,
+			FIXED,	// scripts run in steps of the fixed timestep
+		};
+
+		Mode mode{Mode::VARIABLE};
+		bool interpolate{true};	 // draws between the last two fixed steps
+		float maxFps{0};		 // 0 for no limit
+		float spinTime{0.001f};	 // the end of each wait, spun rather than slept
+	};
+
+	struct GcStats {
+		float stepTime{0};
+		size_t heapSize{0};
+		uint32_t steps{0};
+		uint32_t cycles{0};
+	};
+
+	// seconds spent in each step, the Lua setup runs while the device is created
+	struct StartupStats {
+		float engineTime{0};
+		float windowTime{0};
+		float rendererTime{0};
+		float luaTime{0};
+		float sceneReadTime{0};
+		float waitTime{0};	// for the Lua setup, once the renderer is made
+		float totalTime{0};
+	};
+
+	// the first scene is read and compiled during startup, switching to it runs it
+	y3(uint32_t width, uint32_t height, const std::string& firstScene = "main");
 
 	~y3();
 
@@ -14,30 +87,263 @@ public:
 
 	void initLuaBindings();
 
-	void initLuaTypes();
+	static void initLuaTypes(sol::state_view);
 
 	void removeScene();
 
 	void switchScene(const std::string& name);
 
+	void preloadScene(const std::string& name, float budget = 0.002f);
+
+	void bakeScene(const std::string& name);
+
 	void destroyScene(const std::string& name);
 
 	void addGlobalScript(std::shared_ptr<etna::Script> script);
 
 	void removeGlobalScript(const std::string& name);
 
-	sol::table getAsset(const std::string& name);
+	sol::object getAsset(const std::string& kind, sol::table params);
+
+	sol::table getAssetStats();
+
+	sol::table getFrameStats(uint32_t frames);
+
+	// scripts that took the most time in their hooks, while profiling
+	std::vector<etna::ScriptHandle> getTopScripts(size_t count);
+
+	void printScriptStats(size_t count);
+
+	// GPU buffers by owner, device memory, live nodes by type and the Lua heap
+	sol::table getResourceStats();
+
+	void printResourceStats();
+
+	// allocations of the Lua state, in total, last frame and by size class
+	sol::table getLuaAllocStats();
+
+	// input and dt of every frame to a file, with the seed of math.random
+	void recordInput(const std::string& path);
+
+	// plays a recording back, run returns at its end. The frame times of the
+	// replay are printed, and written one per line in ms if timesPath is given
+	void replayInput(const std::string& path, const std::string& timesPath = "");
+
+	void stopInputRecording();
+
+	// frames without render or swap, e.g. for replays timed on the code rather than
+	// on the display and its vsync
+	void setHeadless(bool headless) { m_headless = headless; }
+
+	// prints the resource stats every interval seconds, 0 to stop
+	void setStatsLog(float interval) { m_statsInterval = interval; }
+
+	// hot reloads the modules that change under dir, off until it's called
+	void watch(const std::string& dir);
+
+	etna::MeshHandle getPrimitive(const std::string& name);
+
+	// sizes in the order the engine takes them, precision is only for spheres
+	struct ShapeParams {
+		float size[3]{1, 1, 1};
+		uint32_t precision{0};
+	};
+
+	etna::MeshHandle getShape(const std::string& shape, sol::table params);
+
+	etna::MeshHandle getShape(const std::string& shape, const ShapeParams&);
+
+	etna::MeshHandle loadMesh(const std::string& path);
+
+	etna::MaterialHandle getColorMaterial(etna::Color, bool point = false);
+
+	etna::MaterialHandle getGridMaterial(sol::table params,
+										 bool transparent = false);
+
+	etna::MaterialHandle getGridMaterial(const etna::engine::GridMaterialParams&,
+										 bool transparent = false);
+
+	etna::MaterialTemplateHandle getMaterialTemplate(sol::table params);
+
+	etna::MaterialTemplateHandle getMaterialTemplate(
+		const etna::MaterialTemplate::CreateInfo&);
+
+	etna::MaterialHandle getMaterial(sol::table params);
+
+	etna::MaterialHandle getMaterial(etna::MaterialTemplateHandle,
+									 const void* params,
+									 size_t size);
+
+	void setLoopSettings(const LoopSettings&);
+
+	const LoopSettings& getLoopSettings() const { return m_loopSettings; }
+
+	void setGcSettings(const GcSettings&);
+
+	const GcSettings& getGcSettings() const { return m_gcSettings; }
+
+	const GcStats& getGcStats() const { return m_gcStats; }
+
+	PreloadStatus getPreloadStatus(const std::string& name) const;
+
+	const StartupStats& getStartupStats() const { return m_startupStats; }
+
+	// 0 for no budget
+	void setSceneBudget(size_t bytes);
+
+	sol::table getSceneMemory();
 
 	static etna::Window* g_window;
 
+	// prints the pipelines made by the startup and by every scene load, read as
+	// the app is made, e.g. from --pipeline-stats
+	static bool g_pipelineStats;
+
 private:
-	sol::state m_lua;
+	// before m_lua, which frees its heap through it
+	etna::LuaAllocator m_luaAllocator;
+	sol::state m_lua{sol::default_at_panic, &etna::LuaAllocator::allocate,
+					 &m_luaAllocator};
 	sol::table y3_table;
+	StartupStats m_startupStats;
+
+	// chunks of scene files compiled ahead, run by the next load of the scene
+	std::unordered_map<std::string, sol::protected_function> m_compiledScenes;
+
+	void setupLua(const std::string& firstScene);
+
+	etna::CoroutineScheduler m_coroutines;
+	etna::ParallelScripts m_parallelScripts;
+
+	etna::InputDispatcher m_input;
+	etna::InputRecording m_inputRecording;
+	std::vector<float> m_replayTimes;
+	std::string m_replayTimesPath;
+	bool m_headless{false};
+
+	// false once a replay is over
+	bool updateInput(float& dt);
+
+	void finishReplay();
+
+	etna::FrameProfiler m_profiler;
+	etna::GpuProfiler m_gpuProfiler;
 	etna::Renderer* m_renderer{nullptr};
 	etna::Scene* m_currScene{nullptr};
 	std::unordered_map<std::string, std::unique_ptr<etna::Scene>> m_scenes;
 	std::unordered_map<std::string, etna::ScriptHandle> m_globalScripts;
-	std::unordered_map<std::string, sol::table> m_assets;
+	etna::AssetCache m_assets;
+	std::vector<uint8_t> m_paramsScratch;
+
+	std::shared_ptr<void> createAsset(
+		const std::string& kind,
+		std::string_view recipe,
+		const std::unordered_map<etna::AssetCache::Key, std::shared_ptr<void>>&);
+
+	// what the baker needs to know that the nodes don't keep
+	struct CameraRecord {
+		std::weak_ptr<etna::_SceneNode> node;
+		etna::Camera::CreateInfo info;
+		etna::Viewport viewport;
+	};
+
+	std::unordered_map<std::string, std::weak_ptr<etna::Script>> m_namedScripts;
+	std::vector<std::weak_ptr<etna::Script>> m_scripts;
+	size_t m_liveScripts{64};
+	std::unordered_map<const etna::_SceneNode*, CameraRecord> m_cameraRecords;
+
+	std::unique_ptr<etna::Scene> loadBakedScene(const std::string& name);
+
+	std::unique_ptr<etna::FileWatcher> m_watcher;
+	std::string m_reloadSource;
+	uint32_t m_reloadedScripts{0};
+
+	etna::ScriptHandle registerScript(etna::ScriptHandle);
+
+	void updateHotReload();
+
+	void reloadModule(const std::string& module, const std::string& path);
+
+	uint64_t m_frame{0};
+	uint64_t m_step{0};	 // of the simulation, as many as frames unless it's fixed
+	float m_dt{0};
+	float m_fixedTimestep{1.f / 60};
+	float m_fixedAccumulator{0};
+
+	LoopSettings m_loopSettings;
+	float m_stepAccumulator{0};
+	etna::Scene* m_interpolatedScene{nullptr};
+	Clock::time_point m_nextFrame;
+
+	void runStep(float dt);
+
+	// returns where the render falls between the last two steps
+	float runFixedSteps(float dt);
+
+	void limitFrameRate();
+
+	void applyFixedUpdateScripts(float dt);
+
+	void applyGlobalScripts(float dt);
+
+	float m_statsInterval{0};
+	Clock::time_point m_lastStatsLog;
+
+	void updateStatsLog();
+
+	sol::table m_inputTable;
+	uint64_t m_inputTableStep{UINT64_MAX};
+
+	sol::table getInputTable();
+
+	struct ScenePreload {
+		std::future<std::string> source;
+		sol::thread thread;
+		std::unique_ptr<etna::Scene> scene;
+		float budget{0};
+		PreloadStatus status;
+	};
+
+	std::unordered_map<std::string, ScenePreload> m_preloads;
+
+	static std::string getScenePath(const std::string& name);
+
+	std::unique_ptr<etna::Scene> buildScene(sol::table nodes);
+
+	std::unique_ptr<etna::Scene> buildScene(const std::vector<etna::SceneNode>&);
+
+	std::unique_ptr<etna::Scene> loadScene(const std::string& name);
+
+	bool stepPreload(const std::string& name, ScenePreload&, Clock::time_point end);
+
+	void updatePreloads();
+
+	// Lua bytes are what the heap grew by while the scene was loading
+	struct SceneUsage {
+		size_t luaBytes{0};
+		uint64_t lastUsed{0};
+	};
+
+	std::unordered_map<std::string, SceneUsage> m_sceneUsage;
+	size_t m_sceneBudget{0};
+	bool m_evictPending{false};	 // evictions wait for the end of the frame
+
+	void touchCurrentScene();
+
+	void addLuaBytes(const std::string& scene, size_t before);
+
+	size_t getSceneGpuBytes(const etna::Scene&) const;
+
+	size_t getMemoryUsage() const;
+
+	void evictScenes();
+
+	GcSettings m_gcSettings;
+	GcStats m_gcStats;
+	size_t m_gcThreshold{0};
+	bool m_gcCycleActive{false};
+
+	void stepGarbageCollector(Clock::time_point frameStart);
 
 public:
 	y3(const y3&) = delete;